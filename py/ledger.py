@@ -0,0 +1,56 @@
+import numpy as np
+
+# Reads trade ledgers written by Economy::enable_ledger (see src/base/ledger.h for the layout)
+# Columns are numpy views into a memory map of the file, so nothing is copied until they're combined
+
+MAGIC = b"fastACEx"
+VERSION = 1
+
+COLUMNS = [
+    ("key", np.uint64),
+    ("price", np.float64),
+    ("labor", np.float64),
+    ("quantities", np.float64),  # numGoods columns, returned as a (numRows, numGoods) view
+    ("time", np.uint32),
+    ("buyer", np.uint32),
+    ("seller", np.uint32),
+    ("units", np.uint32),
+    ("kind", np.uint8),  # 0 for goods, 1 for labor (where the buyer is the firm)
+]
+
+
+def _padded(numBytes):
+    return (numBytes + 7) // 8 * 8
+
+
+def read_chunks(path):
+    """Returns a list of chunks, one per time step with trades, each a dict of column name -> array view"""
+    data = np.memmap(path, dtype=np.uint8, mode="r")
+    if bytes(data[:8]) != MAGIC:
+        raise ValueError(f"{path} is not a ledger")
+    version, numGoods = np.frombuffer(data, dtype=np.uint32, count=2, offset=8)
+    if version != VERSION:
+        raise ValueError(f"{path} has ledger version {version}, expected {VERSION}")
+    chunks = []
+    offset = 16
+    while offset < len(data):
+        numRows = int(np.frombuffer(data, dtype=np.uint64, count=1, offset=offset)[0])
+        offset += 16
+        chunk = {}
+        for name, dtype in COLUMNS:
+            count = numRows * numGoods if name == "quantities" else numRows
+            column = np.frombuffer(data, dtype=dtype, count=count, offset=offset)
+            if name == "quantities":
+                column = column.reshape(numGoods, numRows).T
+            chunk[name] = column
+            offset += _padded(count * np.dtype(dtype).itemsize)
+        chunks.append(chunk)
+    return chunks
+
+
+def read_ledger(path):
+    """Returns every trade in the ledger as one dict of column name -> array (copies the columns once)"""
+    chunks = read_chunks(path)
+    if not chunks:
+        return {}
+    return {name: np.concatenate([chunk[name] for chunk in chunks]) for name, _ in COLUMNS}
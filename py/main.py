@@ -81,7 +81,9 @@ class TrainingParams(ctypes.Structure):
         ('episodeBatchSizeForLRDecay', ctypes.c_uint),
         ('patienceForLRDecay', ctypes.c_uint),
         ('multiplierForLRDecay', ctypes.c_double),
-        ('reverseAnnealingPeriod', ctypes.c_uint)
+        ('reverseAnnealingPeriod', ctypes.c_uint),
+        ('numThreads', ctypes.c_uint),
+        ('seed', ctypes.c_uint)
     ]
 
 
@@ -99,6 +101,14 @@ lib.run.argtypes = [
 ]
 lib.run.restype = None
 
+lib.run_ensemble.argtypes = [
+    ctypes.POINTER(ctypes.c_double),
+    ctypes.POINTER(CustomScenarioParams),
+    ctypes.POINTER(TrainingParams),
+    ctypes.c_uint
+]
+lib.run_ensemble.restype = None
+
 lib.train.argtypes = [
     ctypes.POINTER(ctypes.c_double),
     ctypes.POINTER(CustomScenarioParams),
@@ -126,6 +136,32 @@ def train(
     return list(losses)
 
 
+def run_ensemble(
+    scenarioParams: CustomScenarioParams,
+    trainingParams: TrainingParams,
+    numEconomies: int
+) -> dict:
+    # per-step statistics across numEconomies independent runs of the scenario
+    numGoods = 2  # custom scenarios always have two goods
+    rowSize = 3 + 3 * numGoods
+    output = ctypes.ARRAY(ctypes.c_double, trainingParams.episodeLength * rowSize)()
+    lib.run_ensemble(
+        output,
+        ctypes.POINTER(CustomScenarioParams)(scenarioParams),
+        ctypes.POINTER(TrainingParams)(trainingParams),
+        numEconomies
+    )
+    rows = [list(output[t * rowSize:(t + 1) * rowSize]) for t in range(trainingParams.episodeLength)]
+    return {
+        'meanMoney': [row[0] for row in rows],
+        'meanNumOffers': [row[1] for row in rows],
+        'meanNumJobOffers': [row[2] for row in rows],
+        'meanInventory': [row[3:3 + numGoods] for row in rows],
+        'stdInventory': [row[3 + numGoods:3 + 2 * numGoods] for row in rows],
+        'meanBestPrice': [row[3 + 2 * numGoods:] for row in rows],
+    }
+
+
 def dict_from_cstruct(struct):
     fields = [field[0] for field in getattr(struct, '_fields_')]
     return {field: getattr(struct, field) for field in fields}
@@ -292,6 +328,13 @@ class RuntimeManager:
         self.save_settings()
         lib.run(self.scenarioParams, self.trainingParams)
 
+    def run_ensemble(self, numEconomies: int, episodeLength=None) -> dict:
+        if not self.settings_synched():
+            return
+        self.set_episode_params(episodeLength=episodeLength)
+        self.save_settings()
+        return run_ensemble(self.scenarioParams, self.trainingParams, numEconomies)
+
 
 
 def main():
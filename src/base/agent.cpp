@@ -1,24 +1,46 @@
 #include "base.h"
 
 
-Agent::Agent(Economy* economy) : economy(economy), money(0), time(economy->get_time()) {
-    inventory = Eigen::ArrayXd::Zero(economy->get_numGoods());
-}
+Agent::Agent(Economy* economy) : Agent(economy, Eigen::ArrayXd::Zero(economy->get_numGoods()), 0) {}
 
 Agent::Agent(
     Economy* economy, Eigen::ArrayXd inventory, double money
-) : economy(economy), inventory(inventory), money(money), time(economy->get_time()) {
+) : economy(economy),
+    inventory(nullptr, 0),
+    money(nullptr),
+    labor(nullptr),
+    time(economy->get_time()),
+    ownInventory(inventory),
+    ownMoney(money)
+{
     assert(inventory.size() == economy->get_numGoods());
+    committedInventory = Goods::Zero(inventory.size());
+    bind_state(ownInventory.data(), &ownMoney, &ownLabor);
+}
+
+void Agent::bind_state(double* inventoryData, double* moneyData, double* laborData) {
+    // placement new is the Eigen-sanctioned way of pointing a Map at new data
+    new (&inventory) Eigen::Map<Goods>(inventoryData, economy->get_numGoods());
+    money.rebind(moneyData);
+    labor.rebind(laborData);
 }
 
 
 bool Agent::time_step() {
-    if (time != economy->get_time()) {
+    unsigned int generation = economy->get_time();
+    if (time != generation) {
         time++;
+        if (time == generation) {
+            economy->numCaughtUp.fetch_add(1, std::memory_order_release);
+        }
+        rng = economy->get_rng(id, time);
+        if (economy->get_lockFreeOffers()) {
+            settle_offers();
+        }
         check_my_offers();
         {
             std::lock_guard<std::mutex> lock(myMutex);
-            util::flush(myOffers);
+            util::flush_if_stale(myOffers, economy->market, numRetiredOffers);
         }
         return true;  // completed successfully
     }
@@ -29,8 +51,20 @@ bool Agent::time_step() {
 
 unsigned int Agent::get_time() const { return time; };
 Economy* Agent::get_economy() const { return economy; }
+unsigned int Agent::get_id() const { return id; }
+unsigned int Agent::get_region() const { return region; }
+util::Philox& Agent::get_rng() { return rng; }
 double Agent::get_money() const { return money; }
-const Eigen::ArrayXd& Agent::get_inventory() const { return inventory; }
+Eigen::Map<const Goods> Agent::get_inventory() const {
+    return Eigen::Map<const Goods>(inventory.data(), inventory.size());
+}
+double Agent::get_labor() const { return labor; }
+
+Eigen::ArrayXd Agent::get_params() const { return Eigen::ArrayXd(0); }
+
+void Agent::set_params(const Eigen::ArrayXd& params) {
+    assert(params.size() == 0);
+}
 
 
 void Agent::add_to_inventory(unsigned int good_id, double quantity) {
@@ -43,121 +77,217 @@ void Agent::add_money(double amount) {
     money += amount;
 }
 
-void Agent::post_offer(std::shared_ptr<Offer> offer) {
-    std::lock_guard<std::mutex> lock(myMutex);
+OfferHandle Agent::post_offer(const Offer& offer) {
     // check that the offerer is the person listing it
-    assert(offer->offerer.lock() == shared_from_this());
-    economy->add_offer(std::weak_ptr<const Offer>(offer));
-    myOffers.push_back(offer);
+    assert(offer.offerer == this);
+    return post_offer(offer.amountLeft, offer.quantities, offer.price);
 }
 
-bool check_inventory_delta(
-    const Eigen::ArrayXd& inventoryLeft,
-    const Eigen::ArrayXd& delta
+OfferHandle Agent::post_offer(
+    unsigned int amount_available,
+    const Eigen::Ref<const Eigen::ArrayXd>& quantities,
+    double price
 ) {
-    bool ok = true;
-    for (unsigned int i = 0; i < inventoryLeft.size(); i++) {
-        if (delta(i) > inventoryLeft(i)) {
-            ok = false;
-        }
-    }
-    return ok;
+    std::lock_guard<std::mutex> lock(myMutex);
+    std::uint64_t key = (std::uint64_t(id) << 32) | numOffersPosted++;
+    OfferHandle handle = economy->add_offer(this, amount_available, quantities, price, key);
+    myOffers.push_back(handle);
+    committedInventory += quantities * amount_available;
+    return handle;
+}
+
+Offer* Agent::lookup_offer(OfferHandle offer) {
+    return economy->market.get(offer);
 }
 
-void update_offer_amount_left(
-    Eigen::ArrayXd& inventoryLeft,
-    const Eigen::ArrayXd& offerQuants,
-    unsigned int& offerAmtLeft  // will be updated in place
+// returns the number of units taken off the offer
+unsigned int update_offer_amount_left(
+    Goods& inventoryLeft,
+    Offer* offer  // amountLeft will be updated in place
 ) {
-    // delta is the amount of goods needed to fulfill this offer
-    Eigen::ArrayXd delta = offerQuants * offerAmtLeft;
-    unsigned int reduction = 0;
-    bool ok = false;
-    while (!ok) {
-        ok = check_inventory_delta(inventoryLeft, delta);
-        if (!ok) {
-            delta -= offerQuants;
-            offerAmtLeft--;
-        }
-    }
-    inventoryLeft -= delta;
+    // units sold but not settled for yet are still in inventory, but can't cover anything else
+    unsigned int pending = offer->get_amountPending();
+    inventoryLeft -= offer->quantities * pending;
+    unsigned int coverable = util::get_coverable(inventoryLeft, offer->quantities, offer->amountLeft);
+    // buyers may have reserved more units in the meantime, in which case there's even less to cover
+    unsigned int removed = 0;
+    offer->limit_amountLeft(coverable, removed);
+    unsigned int committed = offer->get_amountCommitted();
+    inventoryLeft -= offer->quantities * (committed - std::min(committed, pending));
+    return removed;
 }
 
 void Agent::check_my_offers() {
     // default implementation just checks whether this agent can actually still fulfill all posted offers
-    // inventoryLeft keeps track of how much of each good would be left after filling offers
     std::lock_guard<std::mutex> lock(myMutex);
-    Eigen::ArrayXd inventoryLeft = inventory;
-    for (auto offer : myOffers) {
+    // if inventory still covers everything that's been committed, no offer needs trimming
+    if ((committedInventory <= inventory).all()) {
+        return;
+    }
+    // otherwise fall back to trimming offers one by one, recomputing committedInventory as we go
+    // inventoryLeft keeps track of how much of each good would be left after filling offers
+    Goods inventoryLeft = inventory;
+    committedInventory.setZero();
+    for (auto handle : myOffers) {
+        Offer* offer = lookup_offer(handle);
+        if (offer == nullptr) {
+            continue;
+        }
+        unsigned int amountBefore = offer->amountLeft;
         // changes inventoryLeft and offer->amountLeft in place
-        update_offer_amount_left(
-            inventoryLeft, offer->quantities, offer->amountLeft
-        );
+        economy->record_withdrawal(*offer, update_offer_amount_left(inventoryLeft, offer));
+        if (amountBefore > 0 && offer->amountLeft == 0) {
+            economy->retire_offer(handle);
+        }
+        committedInventory += offer->quantities * offer->get_amountCommitted();
     }
 }
 
-bool Agent::respond_to_offer(std::weak_ptr<const Offer> offer_) {
+void Agent::release_committed(const Offer& offer, unsigned int amount) {
+    committedInventory -= offer.quantities * amount;
+}
+
+unsigned int Agent::respond_to_offer(OfferHandle handle, unsigned int amount) {
     // check that the agent actually has enough money, then send to offerer
-    auto offer = offer_.lock();
-    if (offer != nullptr && money >= offer->price) {
-        util::print_status(this, "Asking for offer acceptance...");
-        bool accepted = offer->offerer.lock()->review_offer_response(shared_from_this(), offer);
-        if (accepted) {
-            std::lock_guard<std::mutex> lock(myMutex);
-            // complete the transaction on this end
-            money -= offer->price;
-            inventory += offer->quantities;
-            // transaction successful
-            return true;
-        }
+    if (economy->get_lockFreeOffers()) {
+        return reserve_offer(handle, amount);
     }
-    // unsuccessful
-    return false;
+    const Offer* offer = economy->get_offer(handle);
+    if (offer == nullptr || !economy->can_trade(this, offer->offerer)) {
+        return 0;
+    }
+    amount = util::get_affordable(money, offer->price, amount);
+    if (amount == 0) {
+        return 0;
+    }
+    trace::record(3, trace::Event::RespondToOffer, id, time, handle.index, offer->price);
+    unsigned int accepted = offer->offerer->review_offer_response(shared_from_this(), handle, amount);
+    if (accepted > 0) {
+        std::lock_guard<std::mutex> lock(myMutex);
+        // complete the transaction on this end
+        money -= offer->price * accepted;
+        inventory += offer->quantities * accepted;
+        economy->record_fill(this, *offer, accepted);
+    }
+    return accepted;
 }
 
-bool Agent::review_offer_response(std::shared_ptr<Agent> responder, std::weak_ptr<const Offer> offer) {
-    std::shared_ptr<const Offer> offer_ = offer.lock();
-    std::shared_ptr<Offer> myCopy;
-    {
-        std::lock_guard<std::mutex> lock(myMutex);
-        util::print_status(this, "Reviewing offer response...");
-        if (!offer_->is_available()) {
-            util::print_status(this, "Requested offer is not available.");
-            return false;
+void Agent::place_orders(const std::vector<Order<Offer>>& orders) {
+    if (economy->get_batchedClearing()) {
+        economy->batchClearing.add_orders(this, orders);
+        return;
+    }
+    for (auto order : orders) {
+        if (order.amount > 0) {
+            respond_to_offer(order.offer, order.amount);
         }
-        // check that the offer is in myOffers
-        for (auto myOffer : myOffers) {
-            if (myOffer == offer_) {
-                myCopy = myOffer;
-                break;
-            }
+    }
+}
+
+void Agent::withdraw_offer(OfferHandle handle) {
+    if (economy->get_batchedClearing()) {
+        economy->batchClearing.add_withdrawal(handle);
+        return;
+    }
+    Offer* offer = lookup_offer(handle);
+    if (offer != nullptr) {
+        // exchange, since buyers in lock-free mode may still be reserving units
+        unsigned int amountLeft = offer->amountLeft.exchange(0);
+        if (amountLeft > 0) {
+            release_committed(*offer, amountLeft);
+            economy->record_withdrawal(*offer, amountLeft);
+            economy->retire_offer(handle);
         }
-        if (myCopy == nullptr) {
-            return false;
+    }
+}
+
+unsigned int Agent::reserve_offer(OfferHandle handle, unsigned int amount) {
+    Offer* offer = lookup_offer(handle);
+    if (offer == nullptr || offer->offerer == this || !economy->can_trade(this, offer->offerer)) {
+        return 0;
+    }
+    std::lock_guard<std::mutex> lock(myMutex);
+    // only reserve what this agent can pay for, so that a reservation never has to be given back
+    bool soldOut = false;
+    unsigned int reserved = offer->reserve(util::get_affordable(money, offer->price, amount), soldOut);
+    if (reserved == 0) {
+        return 0;
+    }
+    trace::record(3, trace::Event::ReserveOffer, id, time, handle.index, offer->price);
+    money -= offer->price * reserved;
+    inventory += offer->quantities * reserved;
+    // the offerer's side of the transaction is completed in its settle_offers
+    economy->record_fill(this, *offer, reserved);
+    if (soldOut) {
+        economy->retire_offer(handle);
+    }
+    return reserved;
+}
+
+unsigned int Agent::review_offer_response(std::shared_ptr<Agent> responder, OfferHandle handle, unsigned int amount) {
+    // the lock is held until the sale is done, so concurrent buyers can't both take the same units
+    std::lock_guard<std::mutex> lock(myMutex);
+    trace::record(3, trace::Event::ReviewOfferResponse, id, time, handle.index, amount);
+    Offer* offer = lookup_offer(handle);
+    // check that the offer is one of this agent's; the handle's generation guarantees it's the same offer
+    if (offer == nullptr || offer->offerer != this) {
+        return 0;
+    }
+    if (!offer->is_available()) {
+        trace::record(3, trace::Event::OfferUnavailable, id, time, handle.index);
+        return 0;
+    }
+    amount = std::min<unsigned int>(amount, offer->amountLeft);
+    // make sure this agent can actually deliver the goods
+    unsigned int coverable = util::get_coverable(inventory, offer->quantities, amount);
+    if (coverable < amount) {
+        trace::record(3, trace::Event::CannotAfford, id, time, handle.index, offer->price);
+        // sell what's covered, then take the rest of the offer off the market
+        unsigned int amountLeft = offer->amountLeft.exchange(coverable);
+        if (amountLeft > coverable) {
+            release_committed(*offer, amountLeft - coverable);
+            economy->record_withdrawal(*offer, amountLeft - coverable);
         }
-        // need to use myCopy from here since it's not const
-        // make sure this agent can actually afford the transaction
-        if ((inventory < myCopy->quantities).any()) {
-            util::print_status(this, "I can't afford to fulfill this offer.");
-            // mark for removal and return false
-            myCopy->amountLeft = 0;
-            return false;
+        if (coverable == 0) {
+            if (amountLeft > 0) {
+                economy->retire_offer(handle);
+            }
+            return 0;
         }
+        amount = coverable;
     }
     // all good, let's go!
-    accept_offer_response(myCopy);
-    return true;
+    accept_offer_response(handle, offer, amount);
+    return amount;
 }
 
-void Agent::accept_offer_response(std::shared_ptr<Offer> offer) {
+void Agent::accept_offer_response(OfferHandle handle, Offer* offer, unsigned int amount) {
+    trace::record(3, trace::Event::AcceptOfferResponse, id, time, handle.index, offer->price * amount);
+    money += offer->price * amount;
+    inventory -= offer->quantities * amount;
+    // mark that these have actually been sold
+    offer->amountTaken += amount;
+    release_committed(*offer, amount);
+    if ((offer->amountLeft -= amount) == 0) {
+        economy->retire_offer(handle);
+    }
+}
+
+
+void Agent::settle_offers() {
     std::lock_guard<std::mutex> lock(myMutex);
-    util::print_status(this, "Accepting offer response...");
-    money += offer->price;
-    inventory -= offer->quantities;
-    // change listing to -= 1 amount available
-    offer->amountLeft--;
-    // mark that one of these has actually been sold
-    offer->amountTaken++;
+    for (auto handle : myOffers) {
+        Offer* offer = lookup_offer(handle);
+        if (offer == nullptr) {
+            continue;
+        }
+        unsigned int numSold = offer->amountUnsettled.exchange(0);
+        if (numSold > 0) {
+            money += offer->price * numSold;
+            inventory -= offer->quantities * numSold;
+            release_committed(*offer, numSold);
+        }
+    }
 }
 
 
@@ -0,0 +1,80 @@
+#include <assert.h>
+#include <algorithm>
+#include "agentStateStore.h"
+#include "base.h"
+
+
+AgentStateStore::AgentStateStore(unsigned int numGoods) : numGoods(numGoods) {
+    reserve(64);
+}
+
+
+void AgentStateStore::reserve(unsigned int newCapacity) {
+    if (newCapacity <= capacity) {
+        return;
+    }
+    inventories.conservativeResize(newCapacity, numGoods);
+    money.conservativeResize(newCapacity);
+    labor.conservativeResize(newCapacity);
+    capacity = newCapacity;
+    // storage may have moved, so all existing views are stale
+    for (unsigned int id = 0; id < numAgents; id++) {
+        bind(id);
+    }
+}
+
+
+void AgentStateStore::bind(unsigned int id) {
+    agents[id]->bind_state(
+        inventories.row(id).data(),
+        money.data() + id,
+        labor.data() + id
+    );
+}
+
+
+unsigned int AgentStateStore::add_agent(Agent* agent) {
+    assert(agent->get_inventory().size() == numGoods);
+    if (numAgents == capacity) {
+        reserve(std::max(64u, 2 * capacity));
+    }
+    unsigned int id = numAgents++;
+    inventories.row(id) = agent->get_inventory().transpose();
+    money(id) = agent->get_money();
+    labor(id) = agent->get_labor();
+    agents.push_back(agent);
+    bind(id);
+    return id;
+}
+
+
+unsigned int AgentStateStore::get_numAgents() const { return numAgents; }
+
+unsigned int AgentStateStore::get_numGoods() const { return numGoods; }
+
+Agent* AgentStateStore::get_agent(unsigned int id) const { return agents[id]; }
+
+Eigen::Ref<const AgentStateStore::InventoryMatrix> AgentStateStore::get_inventories() const {
+    return inventories.topRows(numAgents);
+}
+
+Eigen::Ref<const Eigen::ArrayXd> AgentStateStore::get_money() const {
+    return money.head(numAgents);
+}
+
+Eigen::Ref<const Eigen::ArrayXd> AgentStateStore::get_labor() const {
+    return labor.head(numAgents);
+}
+
+
+Eigen::ArrayXd AgentStateStore::get_total_inventory() const {
+    return get_inventories().colwise().sum().transpose();
+}
+
+double AgentStateStore::get_total_money() const {
+    return get_money().sum();
+}
+
+double AgentStateStore::get_total_labor() const {
+    return get_labor().sum();
+}
@@ -0,0 +1,61 @@
+#ifndef AGENT_STATE_STORE_H
+#define AGENT_STATE_STORE_H
+
+#include <vector>
+#include <Eigen/Dense>
+
+
+class Agent;
+
+
+class AgentStateStore {
+    /**
+     * Columnar storage for the inventories, money, and labor of every agent in an Economy.
+     *
+     * Each agent gets a dense id when it is added; row id of the inventory matrix,
+     * and entry id of the money and labor vectors, belong to that agent.
+     * Agents' inventory, money, and labor members are views into this storage,
+     * so economy-wide passes can be done as single Eigen operations over contiguous memory
+     * instead of chasing pointers to each agent.
+     *
+     * The store grows geometrically as agents are added; when it does, every agent's views are rebound.
+     * Agents should therefore only be added between time steps.
+     */
+public:
+    // row-major so that each agent's inventory is contiguous
+    using InventoryMatrix = Eigen::Array<double, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor>;
+
+    AgentStateStore(unsigned int numGoods);
+
+    // copies the agent's current state into a new row and points the agent's views at it
+    // returns the agent's id in the store
+    unsigned int add_agent(Agent* agent);
+
+    unsigned int get_numAgents() const;
+    unsigned int get_numGoods() const;
+    Agent* get_agent(unsigned int id) const;
+
+    // only the first get_numAgents() rows / entries are in use
+    Eigen::Ref<const InventoryMatrix> get_inventories() const;
+    Eigen::Ref<const Eigen::ArrayXd> get_money() const;
+    Eigen::Ref<const Eigen::ArrayXd> get_labor() const;
+
+    Eigen::ArrayXd get_total_inventory() const;
+    double get_total_money() const;
+    double get_total_labor() const;
+
+private:
+    void reserve(unsigned int newCapacity);
+    void bind(unsigned int id);
+
+    unsigned int numGoods;
+    unsigned int numAgents = 0;
+    unsigned int capacity = 0;
+
+    InventoryMatrix inventories;
+    Eigen::ArrayXd money;
+    Eigen::ArrayXd labor;
+    std::vector<Agent*> agents;
+};
+
+#endif
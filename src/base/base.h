@@ -3,6 +3,7 @@
 
 #include <algorithm>
 #include <assert.h>
+#include <atomic>
 #include <iostream>
 #include <memory>
 #include <mutex>
@@ -10,7 +11,19 @@
 #include <thread>
 #include <vector>
 #include <Eigen/Dense>
+#include "goods.h"
 #include "util.h"
+#include "trace.h"
+#include "philox.h"
+#include "slotMap.h"
+#include "threadPool.h"
+#include "agentStateStore.h"
+#include "orderBook.h"
+#include "batchClearing.h"
+#include "laborMatching.h"
+#include "ledger.h"
+#include "marketStats.h"
+#include "marketSnapshot.h"
 
 
 class Agent;
@@ -20,59 +33,115 @@ class Firm;
 
 class BaseOffer {
     // Base class from which Offer and JobOffer inherit
+    // offers are stored by value in the Economy's markets & referred to by Handle
 public:
+    BaseOffer();
     BaseOffer(
-        std::weak_ptr<Agent> offerer,
+        Agent* offerer,
         unsigned int amount_available
     );
+    // copies take a snapshot of the counters
+    BaseOffer(const BaseOffer& other);
+    BaseOffer& operator=(const BaseOffer& other);
     virtual ~BaseOffer() {}
 
-    unsigned int amountLeft;
-	unsigned int amountTaken = 0;
+    // the counters are atomic so that buyers can reserve units without locking the offerer
+    std::atomic<unsigned int> amountLeft;
+	std::atomic<unsigned int> amountTaken{0};
+    // units taken through the lock-free path that the offerer hasn't been settled for yet
+    std::atomic<unsigned int> amountUnsettled{0};
+    // units buyers are partway through reserving, which may have left amountLeft but not yet reached amountUnsettled
+    std::atomic<unsigned int> amountReserving{0};
     // the agent who posted the offer
-    std::weak_ptr<Agent> offerer;
+    // agents outlive the markets' offers, since both are owned by the Economy
+    Agent* offerer;
+    // offerer's id in the high 32 bits & the offerer's count of previously posted offers in the low 32 bits
+    // unlike handles, which depend on the order threads happen to post in, keys are reproducible,
+    // so anything that orders offers should order them by key
+    std::uint64_t key = 0;
 
     // unavailable offers will be swept up by the parent economy
     // in most cases just returns whether amountLeft > 0
     virtual bool is_available() const;
+    // atomically takes up to amount units, as many as are left, & adds them to amountUnsettled; returns the number taken
+    // soldOut is set to whether this call took the last unit
+    unsigned int reserve(unsigned int amount, bool& soldOut);
+    // units the offerer still owes: those left plus those sold but not settled
+    // safe to call while buyers are reserving; units partway through a reservation may be counted twice, but never missed
+    unsigned int get_amountCommitted() const;
+    // units sold (or being sold) through the lock-free path that the offerer hasn't been settled for yet
+    // like get_amountCommitted, never misses units partway through a reservation
+    unsigned int get_amountPending() const;
+    // atomically lowers amountLeft to at most maxAmount, without undoing concurrent reservations
+    // returns the resulting amountLeft; removed is set to the number of units this call took off
+    unsigned int limit_amountLeft(unsigned int maxAmount, unsigned int& removed);
+
+protected:
+    // resets every member to that of a freshly posted offer; used when recycling market slots
+    void reset(Agent* offerer, unsigned int amount_available, std::uint64_t key);
 };
 
 
 class Offer : public BaseOffer {
 public:
+    Offer();
     Offer(
-        std::weak_ptr<Agent> offerer,
+        Agent* offerer,
         unsigned int amount_available,
-        Eigen::ArrayXd quantities,
+        const Eigen::Ref<const Eigen::ArrayXd>& quantities,
         double price
     );
 
-    Eigen::ArrayXd quantities;
+    // overwrites this offer with a freshly posted one
+    // quantities keeps its memory if it's already the right size (or is fixed-size; see goods.h),
+    // so recycled market slots don't reallocate
+    void assign(
+        Agent* offerer,
+        unsigned int amount_available,
+        const Eigen::Ref<const Eigen::ArrayXd>& quantities,
+        double price,
+        std::uint64_t key
+    );
+
+    Goods quantities;
     double price;
 };
 
 
 class JobOffer : public BaseOffer {
 public:
+    JobOffer();
     JobOffer(
-        std::weak_ptr<Firm> offerer,
+        Firm* offerer,
         unsigned int amount_available,
         double labor,
         double wage
     );
 
+    void assign(
+        Firm* offerer,
+        unsigned int amount_available,
+        double labor,
+        double wage,
+        std::uint64_t key
+    );
+
     double labor;
     double wage;
 };
 
 
+using OfferHandle = Handle<Offer>;
+using JobOfferHandle = Handle<JobOffer>;
+
+
 template <typename T>
 struct Order {
     Order(
-        std::weak_ptr<const T> offer,
+        Handle<T> offer,
         unsigned int amount
     ) : offer(offer), amount(amount) {}
-    std::weak_ptr<const T> offer;
+    Handle<T> offer;
     unsigned int amount;
 };
 
@@ -82,6 +151,17 @@ struct Order {
 
 class Economy {
     // the Economy manages all the agents and holds the markets for goods and labor
+    // agents get mutable access to their own offers through the markets
+    friend class Agent;
+    friend class Person;
+    friend class Firm;
+    // steps many economies together, driving the phases of time_step itself
+    friend class EnsembleRunner;
+    friend class EconomySnapshot;
+    // runs a part of the economy in each of several processes
+    friend class ShardedEconomy;
+    friend class BatchClearing;
+    friend class LaborMatching;
 public:
     Economy(std::vector<std::string> goods);
 
@@ -97,21 +177,148 @@ public:
 
     const std::string& get_name_for_good_id(unsigned int id) const;
 
+    // moves the state of all current and future agents into a columnar AgentStateStore
+    void enable_stateStore();
+    // returns nullptr if enable_stateStore hasn't been called
+    const AgentStateStore* get_stateStore() const;
+    // records every trade from now on in a Ledger written to path, replacing any ledger already enabled
+    // returns false (and records nothing) if the file can't be opened
+    bool enable_ledger(const std::string& path);
+    // writes out everything recorded so far, then stops recording
+    void disable_ledger();
+    // returns nullptr if no ledger is enabled
+    Ledger* get_ledger() const;
+    // keeps per-step market statistics from now on (see MarketStats), starting from the offers on the market now
+    void enable_marketStats();
+    // returns nullptr if enable_marketStats hasn't been called
+    const MarketStats* get_marketStats() const;
+    // economy-wide totals; single vectorized passes if the state store is enabled
+    Eigen::ArrayXd get_total_inventory() const;
+    double get_total_money() const;
+
     const std::vector<std::weak_ptr<Person>>& get_persons() const;
     const std::vector<std::weak_ptr<Firm>>& get_firms() const;
     const std::vector<std::string>& get_goods() const;
     unsigned int get_numGoods() const;
-    const std::vector<std::weak_ptr<const Offer>>& get_market() const;
-    const std::vector<std::weak_ptr<const JobOffer>>& get_jobMarket() const;
-    std::default_random_engine get_rng() const;
-
-    void add_offer(std::weak_ptr<const Offer> offer);
-    void add_jobOffer(std::weak_ptr<const JobOffer> jobOffer);
+    const SlotMap<Offer>& get_market() const;
+    const SlotMap<JobOffer>& get_jobMarket() const;
+    // the offers that were available at the start of the step, taken once at the step barrier (see MarketSnapshot)
+    // agents reading the markets should prefer these, which they can share without locking, copying or sorting
+    const MarketSnapshot<Offer>& get_offerSnapshot() const;
+    const MarketSnapshot<JobOffer>& get_jobOfferSnapshot() const;
+    // return nullptr if the offer is no longer on the market
+    const Offer* get_offer(OfferHandle offer) const;
+    const JobOffer* get_jobOffer(JobOfferHandle jobOffer) const;
+    // the goods market of a region indexed by good & unit price
+    // offers are listed at the phase barriers, so offers posted since the last one aren't in it yet
+    OrderBook& get_orderBook(unsigned int region = 0);
+    // all randomness in the economy is derived from this seed, which is taken from the clock by default
+    // with a fixed seed, random draws don't depend on the number of threads or how they interleave
+    void set_seed(std::uint64_t seed);
+    std::uint64_t get_seed() const;
+    // stream for setup code, e.g. drawing agents' parameters; successive calls continue the same stream
+    util::Philox& get_rng();
+    // independent stream for an agent (by id) at a time step
+    util::Philox get_rng(unsigned int agentId, unsigned int time) const;
+
+    // the pool used to run agents in parallel; created on first use with constants::numThreads threads
+    std::shared_ptr<ThreadPool> get_threadPool();
+    // replaces the pool with a new one of the given size
+    void set_numThreads(unsigned int numThreads);
+    // lets several economies (e.g. successive training episodes) share one pool
+    void set_threadPool(std::shared_ptr<ThreadPool> threadPool);
+
+    // in lock-free mode buyers take units of goods offers with an atomic reservation
+    // instead of going through the offerer's review_offer_response;
+    // offerers are paid & hand over their goods when they next settle (see Agent::settle_offers)
+    void set_lockFreeOffers(bool lockFreeOffers);
+    bool get_lockFreeOffers() const;
+    // in batched mode goods orders & job applications are only collected while agents step,
+    // then executed together after persons and again after firms:
+    // applications are matched by a LaborMatching pass, then goods orders are cleared by a BatchClearing pass
+    // takes precedence over lock-free mode
+    void set_batchedClearing(bool batchedClearing);
+    bool get_batchedClearing() const;
+
+    // splits both markets into regions, each with its own slots, order book & locks,
+    // so that agents posting in different regions never contend
+    // every agent has a home region (by default its id modulo numRegions) where its offers are posted;
+    // when there is more than one region, each region's agents step together on one thread
+    // returns false (and changes nothing) if there are offers on either market or numRegions is out of range
+    bool set_numRegions(unsigned int numRegions);
+    unsigned int get_numRegions() const;
+    // moves an agent to another home region; offers it has already posted stay where they are
+    void set_region(Agent* agent, unsigned int region);
+    // whether agents may take offers posted in other regions; true by default
+    // with it off, regions only interact through dividends paid to owners in other regions,
+    // so without those the outcome of a step doesn't depend on how regions are spread over threads
+    void set_crossRegionTrade(bool crossRegionTrade);
+    bool get_crossRegionTrade() const;
+    // whether buyer may take an offer posted by seller
+    bool can_trade(const Agent* buyer, const Agent* seller) const;
+
+    // takes an offer whose amountLeft has just dropped to 0 off the order book & counts it as a tombstone,
+    // to be erased once enough of the market is dead; should be called exactly once per offer
+    void retire_offer(OfferHandle offer);
+    void retire_jobOffer(JobOfferHandle jobOffer);
+
+    // copy the offer into the market and return a handle to it
+    // thread safe; the offer is listed in its region's order book at the next phase barrier
+    OfferHandle add_offer(const Offer& offer);
+    JobOfferHandle add_jobOffer(const JobOffer& jobOffer);
+    // build the offer directly in a market slot; slots freed when the market is swept at the end of a step
+    // are recycled along with their memory, so steady-state posting doesn't allocate
+    OfferHandle add_offer(
+        Agent* offerer,
+        unsigned int amount_available,
+        const Eigen::Ref<const Eigen::ArrayXd>& quantities,
+        double price,
+        std::uint64_t key
+    );
+    JobOfferHandle add_jobOffer(
+        Firm* offerer,
+        unsigned int amount_available,
+        double labor,
+        double wage,
+        std::uint64_t key
+    );
     
     virtual std::string get_typename() const;
     virtual void print_summary() const;
 
 protected:
+    // the phases of time_step, in order:
+    // begin_step, then check_offers, every person's time_step, end_phase, every firm's time_step, end_phase, end_step
+    // returns false (and does nothing) if some agent hasn't caught up with the economy's time
+    bool begin_step();
+    // the batched form of Agent::check_my_offers over agents [startIdx, endIdx) (persons, then firms),
+    // so they don't each trim their offers as they step; the offers of agents that have committed more than they hold
+    // are gathered into contiguous columns & trimmed in one pass (see util::trim_to_inventory)
+    // must not run while agents are stepping
+    void check_offers(unsigned int startIdx, unsigned int endIdx);
+    // record a trade in the ledger & market statistics, if enabled; called by whoever completes the trade
+    void record_fill(const Agent* buyer, const Offer& offer, unsigned int units);
+    void record_hire(const Person* person, const JobOffer& jobOffer, unsigned int units);
+    // record units taken off an offer without being sold, e.g. withdrawn or trimmed to the offerer's inventory
+    void record_withdrawal(const Offer& offer, unsigned int units);
+    // recounts the market statistics' depth, after the market was changed directly
+    void recount_marketDepth();
+    // recounts the agents that have caught up, after agents' times or the agent lists were changed directly
+    void recount_caughtUp();
+    // the agents' phases, between begin_step & end_step: each Phase in order, with end_phase after Persons & Firms
+    void step_agents();
+    // the work of each phase is split into units that can run in parallel: agents for CheckOffers,
+    // and whole regions for Persons & Firms if there's more than one region (so a region steps on a single thread),
+    // otherwise agents; step_agents & EnsembleRunner both hand these units to a pool
+    enum class Phase { CheckOffers, Persons, Firms };
+    unsigned int get_numPhaseUnits(Phase phase) const;
+    void run_phase(Phase phase, unsigned int startIdx, unsigned int endIdx);
+    // threadPool may be nullptr, to run serially
+    void end_phase(ThreadPool* threadPool);
+    // moves the offers posted since the last barrier into the order books; must not run while agents are stepping
+    void list_pending_offers();
+    void end_step();
+
     std::vector<std::shared_ptr<Person>> persons;
     std::vector<std::shared_ptr<Firm>> firms;
     // persons_weak and firms_weak are to make sharing agents lists easier
@@ -122,11 +329,34 @@ protected:
     /// normally these goods will be referred to by their indices in the goods list
     std::vector<std::string> goods;
     unsigned int numGoods;  // equal to goods.size()
-    std::vector<std::weak_ptr<const Offer>> market;
-    std::vector<std::weak_ptr<const JobOffer>> jobMarket;
-    std::default_random_engine rng;
-    // variable to keep track of time and control when economy can make a time_step()
-    unsigned int time = 0;
+    // the markets own all the offers that agents have posted
+    SlotMap<Offer> market;
+    SlotMap<JobOffer> jobMarket;
+    // one per region, indexing the offers in the market shard of the same number
+    std::vector<std::unique_ptr<OrderBook>> orderBooks;
+    MarketSnapshot<Offer> offerSnapshot;
+    MarketSnapshot<JobOffer> jobOfferSnapshot;
+    BatchClearing batchClearing;
+    LaborMatching laborMatching;
+    std::uint64_t seed;
+    util::Philox rng;  // the setup stream
+    // the step barrier: time is the generation, which begin_step only advances once every agent has caught up with it
+    // agents count themselves into numCaughtUp as they catch up, so that check doesn't have to visit them
+    std::atomic<unsigned int> time{0};
+    std::atomic<unsigned int> numCaughtUp{0};
+
+    std::shared_ptr<ThreadPool> threadPool;
+    std::unique_ptr<AgentStateStore> stateStore;
+    std::unique_ptr<Ledger> ledger;
+    std::unique_ptr<MarketStats> marketStats;
+    bool lockFreeOffers = false;
+    bool batchedClearing = false;
+    unsigned int numRegions = 1;
+    bool crossRegionTrade = true;
+    // when there's more than one region, agents are sorted by region after they're shuffled
+    // and these hold where each region's agents start in persons & firms, plus one past the end
+    std::vector<unsigned int> personsRegionStart;
+    std::vector<unsigned int> firmsRegionStart;
 
     std::mutex mutex;
 };
@@ -135,6 +365,11 @@ protected:
 class Agent : public std::enable_shared_from_this<Agent> {
     // Agents are the most basic member of the economy.
     // They can buy and sell goods, keep inventories, and hold money.
+    friend class Economy;
+    friend class BatchClearing;
+    friend class LaborMatching;
+    friend class EconomySnapshot;
+    friend class ShardedEconomy;
 public:
     // Note: Agents can create shared pointers to themselves, but
     // this means that you _must_ create an Agent as a shared pointer
@@ -146,15 +381,37 @@ public:
 
     unsigned int get_time() const;
     Economy* get_economy() const;
+    // index of this agent in the order agents were added to the economy
+    unsigned int get_id() const;
+    // the market region this agent posts its offers in (see Economy::set_numRegions)
+    unsigned int get_region() const;
+    // random numbers for this agent's decisions; reset to a fresh stream at the start of each of its time steps
+    // should only be used from within this agent's own time step
+    util::Philox& get_rng();
     double get_money() const;
-    const Eigen::ArrayXd& get_inventory() const;
-
-    // Looks at current response to an offer from myOffers and decides whether to accept or reject
-    // won't do anything if the responder doesn't have the offer in myOffers
-    // returns true if offer is accepted & successful
-    // *should call accept_offer_response to determine if it is successful
-    // default implementation accepts all valid responses
-    virtual bool review_offer_response(std::shared_ptr<Agent> responder, std::weak_ptr<const Offer> offer_);
+    // a view of this agent's inventory; only valid until the next agent is added to the economy
+    Eigen::Map<const Goods> get_inventory() const;
+    // labor supplied (for persons) or hired (for firms) this period
+    double get_labor() const;
+    // any parameters that define this agent's behavior, e.g. its utility function's, flattened into one array
+    // these are saved in EconomySnapshots; set_params takes an array laid out like the one get_params returns
+    // by default an agent has no parameters
+    virtual Eigen::ArrayXd get_params() const;
+    virtual void set_params(const Eigen::ArrayXd& params);
+
+    // points this agent's inventory, money, and labor at external storage
+    // called by AgentStateStore; the values at the new location should already be up to date
+    void bind_state(double* inventoryData, double* moneyData, double* laborData);
+
+    // Looks at a response for amount units of an offer from myOffers and decides how many of them to accept
+    // won't do anything if the offer wasn't posted by this agent; ownership is checked in O(1) via the offer's offerer
+    // returns the number of units accepted & successfully sold
+    // *should call accept_offer_response to complete the sale
+    // default implementation accepts as many units as are left & this agent's inventory covers
+    virtual unsigned int review_offer_response(std::shared_ptr<Agent> responder, OfferHandle offer, unsigned int amount);
+    // collects payment for & gives up the goods of any units of this agent's offers
+    // that were taken through the lock-free path since the last settlement
+    void settle_offers();
 
     virtual std::string get_typename() const;
     // print a summary of this agent's current status
@@ -165,11 +422,22 @@ protected:
     Agent(Economy* economy, Eigen::ArrayXd inventory, double money);
 
     Economy* economy;  // the economy this Agent is a part of
-    Eigen::ArrayXd inventory;
+    // inventory, money & labor are views, either of the own* members below or of a row in the economy's AgentStateStore
+    Eigen::Map<Goods> inventory;
     // the offers this agent has listed on the market
-    std::vector<std::shared_ptr<Offer>> myOffers;
-    double money;
+    std::vector<OfferHandle> myOffers;
+    unsigned int numOffersPosted = 0;  // used to assign offer keys
+    // goods needed to fill every unit still outstanding on myOffers (including units taken but not yet settled)
+    // kept up to date as offers are posted, sold & withdrawn, so check_my_offers only has to scan when it exceeds inventory
+    Goods committedInventory;
+    // how many of myOffers have been retired since myOffers was last flushed
+    std::atomic<unsigned int> numRetiredOffers{0};
+    util::ScalarView money;
+    util::ScalarView labor;
     unsigned int time;
+    unsigned int id = 0;  // assigned by the economy
+    unsigned int region = 0;  // assigned by the economy
+    util::Philox rng;
 
     std::mutex myMutex;
 
@@ -180,19 +448,45 @@ protected:
     virtual void buy_goods() {}  // by default does nothing
     // lists offers for goods
     virtual void sell_goods() {} // by default does nothing
-    // indicates that this agent wants an offer
-    virtual bool respond_to_offer(std::weak_ptr<const Offer> offer);
+    // indicates that this agent wants amount units of an offer, which are bought in one transaction
+    // returns the number of units bought, which may be fewer if the buyer can't afford them or the offer runs short
+    virtual unsigned int respond_to_offer(OfferHandle offer, unsigned int amount);
+    // lock-free alternative to the review_offer_response round trip; only locks this agent
+    unsigned int reserve_offer(OfferHandle offer, unsigned int amount);
+    // responds to each order in one transaction, or hands them all to the economy in batched mode
+    void place_orders(const std::vector<Order<Offer>>& orders);
+    // takes an offer off the market; in batched mode this waits until the current clearing pass is done
+    void withdraw_offer(OfferHandle offer);
     // add offer to economy->market and myOffers
-    void post_offer(std::shared_ptr<Offer> offer);
+    OfferHandle post_offer(const Offer& offer);
+    // same, but builds the offer directly in the market without going through a temporary Offer
+    OfferHandle post_offer(
+        unsigned int amount_available,
+        const Eigen::Ref<const Eigen::ArrayXd>& quantities,
+        double price
+    );
+    // mutable access to an offer on the market; returns nullptr if it's gone
+    Offer* lookup_offer(OfferHandle offer);
     // Checks current offers to decide whether to keep them on the market
     virtual void check_my_offers();
-    // called by the offerer during review_offer_response, finalizes a transaction
-    void accept_offer_response(std::shared_ptr<Offer> offer);
+    // called by the offerer during review_offer_response, finalizes the sale of amount units
+    // caller must hold myMutex
+    void accept_offer_response(OfferHandle handle, Offer* offer, unsigned int amount);
+    // records that amount units of one of this agent's offers no longer need to be covered by inventory
+    // caller must hold myMutex (or otherwise have exclusive access to this agent)
+    void release_committed(const Offer& offer, unsigned int amount);
+
+private:
+    // backing storage used until (unless) the agent is moved into an AgentStateStore
+    Goods ownInventory;
+    double ownMoney;
+    double ownLabor = 0.0;
 };
 
 
 class Person : public Agent {
     // Persons are Agents which can also consume their goods and offer labor to Firms
+    friend class LaborMatching;
 public:
     template <typename T, typename ... Args>
 	friend std::shared_ptr<T> util::create(Args&& ... args);
@@ -211,11 +505,13 @@ protected:
     Person(Economy* economy);
     Person(Economy* economy, Eigen::ArrayXd inventory, double money);
 
-	double laborSupplied = 0.0;
+	util::ScalarView& laborSupplied;  // alias for Agent::labor
 
     virtual void search_for_jobs() {}  // currently does nothing
     virtual void consume_goods() {}  // currently does nothing
-    virtual bool respond_to_jobOffer(std::weak_ptr<const JobOffer> jobOffer);
+    virtual bool respond_to_jobOffer(JobOfferHandle jobOffer);
+    // responds to each job one unit at a time, or hands them all to the economy in batched mode
+    void apply_for_jobs(const std::vector<Order<JobOffer>>& applications);
 
 };
 
@@ -223,6 +519,9 @@ protected:
 class Firm : public Agent {
     // Firms can hire laborers (Persons), produce new goods, and pay dividends on profits
     // Firms are owned by other Agents (other firms or persons)
+    friend class Economy;
+    friend class LaborMatching;
+    friend class EconomySnapshot;
 public:
     template <typename T, typename ... Args>
 	friend std::shared_ptr<T> util::create(Args&& ... args);
@@ -239,7 +538,7 @@ public:
     // analagous to Agent::review_offer_response
     virtual bool review_jobOffer_response(
         std::shared_ptr<Person> responder,
-        std::weak_ptr<const JobOffer> jobOffer
+        JobOfferHandle jobOffer
     );
 
 	double get_laborHired() const;
@@ -253,13 +552,19 @@ protected:
 
     std::vector<std::shared_ptr<Agent>> owners;
     // the job offers this firm has listed on the job market
-    std::vector<std::shared_ptr<JobOffer>> myJobOffers;
-	double laborHired = 0.0;
+    std::vector<JobOfferHandle> myJobOffers;
+    std::atomic<unsigned int> numRetiredJobOffers{0};
+	util::ScalarView& laborHired;  // alias for Agent::labor
 
     // analogous to Agent::check_my_offers
     virtual void check_myJobOffers();
-    void accept_jobOffer_response(std::shared_ptr<JobOffer> jobOffer);
-    void post_jobOffer(std::shared_ptr<JobOffer> jobOffer);
+    void accept_jobOffer_response(JobOfferHandle handle, JobOffer* jobOffer);
+    // analogous to Agent::withdraw_offer
+    void withdraw_jobOffer(JobOfferHandle jobOffer);
+    JobOfferHandle post_jobOffer(const JobOffer& jobOffer);
+    JobOfferHandle post_jobOffer(unsigned int amount_available, double labor, double wage);
+    // analogous to Agent::lookup_offer
+    JobOffer* lookup_jobOffer(JobOfferHandle jobOffer);
 };
 
 
@@ -0,0 +1,244 @@
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <numeric>
+#include "batchClearing.h"
+#include "base.h"
+
+
+BatchClearing::BatchClearing(SlotMap<Offer>& market) : market(market) {}
+
+
+void BatchClearing::add_orders(Agent* buyer, const std::vector<Order<Offer>>& newOrders) {
+    std::lock_guard<std::mutex> lock(mutex);
+    for (const auto& order : newOrders) {
+        const Offer* offer = market.get(order.offer);
+        if (
+            offer == nullptr || offer->offerer == buyer || order.amount == 0
+            || !buyer->economy->can_trade(buyer, offer->offerer)
+        ) {
+            continue;
+        }
+        orders.push_back(BatchOrder{buyer, offer->offerer, order.offer, offer->key, order.amount});
+    }
+}
+
+void BatchClearing::add_withdrawal(Handle<Offer> offer) {
+    std::lock_guard<std::mutex> lock(mutex);
+    withdrawals.push_back(offer);
+}
+
+unsigned int BatchClearing::get_numPending() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return orders.size();
+}
+
+
+template <typename Key>
+std::vector<std::pair<unsigned int, unsigned int>> BatchClearing::group_by(
+    const std::vector<unsigned int>& idx, Key key
+) const {
+    std::vector<std::pair<unsigned int, unsigned int>> groups;
+    unsigned int begin = 0;
+    for (unsigned int i = 1; i <= idx.size(); i++) {
+        if (i == idx.size() || key(batch[idx[i]]) != key(batch[idx[begin]])) {
+            groups.push_back(std::make_pair(begin, i));
+            begin = i;
+        }
+    }
+    return groups;
+}
+
+
+void BatchClearing::cap_by_budget(const std::vector<unsigned int>& idx, unsigned int begin, unsigned int end) {
+    double moneyLeft = batch[idx[begin]].buyer->money;
+    for (unsigned int i = begin; i < end; i++) {
+        BatchOrder& order = batch[idx[i]];
+        const Offer* offer = market.get(order.offer);
+        if (offer == nullptr) {
+            order.amount = 0;
+            continue;
+        }
+        order.amount = util::get_affordable(moneyLeft, offer->price, order.amount);
+        moneyLeft -= order.amount * offer->price;
+    }
+}
+
+
+void BatchClearing::ration(const std::vector<unsigned int>& idx, unsigned int begin, unsigned int end) {
+    Agent* seller = batch[idx[begin]].seller;
+    Goods inventoryLeft = seller->inventory;
+    unsigned int offerBegin = begin;
+    while (offerBegin < end) {
+        Handle<Offer> handle = batch[idx[offerBegin]].offer;
+        unsigned int offerEnd = offerBegin;
+        unsigned long long demand = 0;
+        while (offerEnd < end && batch[idx[offerEnd]].offer == handle) {
+            demand += batch[idx[offerEnd]].amount;
+            offerEnd++;
+        }
+        Offer* offer = market.get(handle);
+        if (offer == nullptr || demand == 0) {
+            offerBegin = offerEnd;
+            continue;
+        }
+        // supply is limited both by the offer & by what the seller can actually deliver
+        unsigned int supply = util::get_coverable(inventoryLeft, offer->quantities, offer->amountLeft);
+        unsigned int numFilled = 0;
+        if (demand <= supply) {
+            for (unsigned int i = offerBegin; i < offerEnd; i++) {
+                batch[idx[i]].filled = batch[idx[i]].amount;
+            }
+            numFilled = demand;
+        }
+        else {
+            // proportional rationing by largest remainder; integer arithmetic keeps this exact
+            std::vector<std::pair<unsigned long long, unsigned int>> remainders;
+            for (unsigned int i = offerBegin; i < offerEnd; i++) {
+                BatchOrder& order = batch[idx[i]];
+                unsigned long long share = (unsigned long long)supply * order.amount;
+                order.filled = share / demand;
+                numFilled += order.filled;
+                remainders.push_back(std::make_pair(share % demand, i));
+            }
+            // orders within an offer are sorted by buyer id, so stable_sort breaks ties by id
+            std::stable_sort(
+                remainders.begin(), remainders.end(),
+                [](const std::pair<unsigned long long, unsigned int>& a, const std::pair<unsigned long long, unsigned int>& b) {
+                    return a.first > b.first;
+                }
+            );
+            for (unsigned int j = 0; numFilled < supply; j++) {
+                batch[idx[remainders[j].second]].filled++;
+                numFilled++;
+            }
+        }
+        if (numFilled > 0) {
+            offer->amountTaken += numFilled;
+            inventoryLeft -= offer->quantities * numFilled;
+            seller->money += offer->price * numFilled;
+            seller->inventory -= offer->quantities * numFilled;
+            seller->release_committed(*offer, numFilled);
+            if ((offer->amountLeft -= numFilled) == 0) {
+                seller->economy->retire_offer(handle);
+            }
+        }
+        offerBegin = offerEnd;
+    }
+}
+
+
+void BatchClearing::settle_buyer(const std::vector<unsigned int>& idx, unsigned int begin, unsigned int end) {
+    Agent* buyer = batch[idx[begin]].buyer;
+    for (unsigned int i = begin; i < end; i++) {
+        const BatchOrder& order = batch[idx[i]];
+        if (order.filled == 0) {
+            continue;
+        }
+        const Offer* offer = market.get(order.offer);
+        buyer->money -= offer->price * order.filled;
+        buyer->inventory += offer->quantities * order.filled;
+        buyer->economy->record_fill(buyer, *offer, order.filled);
+    }
+}
+
+
+void BatchClearing::clear(ThreadPool* threadPool) {
+    std::vector<Handle<Offer>> toWithdraw;
+    {
+        // release the lock before running any passes, so that no lock is held across ThreadPool::run
+        std::lock_guard<std::mutex> lock(mutex);
+        batch.swap(orders);
+        toWithdraw.swap(withdrawals);
+    }
+    auto run = [threadPool](unsigned int numTasks, const ThreadPool::Task& task) {
+        if (threadPool != nullptr) {
+            threadPool->run(numTasks, task);
+        }
+        else {
+            task(0, numTasks);
+        }
+    };
+
+    // each pass touches only the agents in its own groups, so no agent locks are needed
+    std::vector<unsigned int> byBuyer(batch.size());
+    std::iota(byBuyer.begin(), byBuyer.end(), 0);
+    std::sort(
+        byBuyer.begin(), byBuyer.end(),
+        [this](unsigned int a, unsigned int b) {
+            const BatchOrder& x = batch[a];
+            const BatchOrder& y = batch[b];
+            if (x.buyer->get_id() != y.buyer->get_id()) {
+                return x.buyer->get_id() < y.buyer->get_id();
+            }
+            if (x.offerKey != y.offerKey) {
+                return x.offerKey < y.offerKey;
+            }
+            return a < b;
+        }
+    );
+    auto buyerGroups = group_by(byBuyer, [](const BatchOrder& o) { return o.buyer; });
+    run(
+        buyerGroups.size(),
+        [&](unsigned int startIdx, unsigned int endIdx) {
+            for (unsigned int i = startIdx; i < endIdx; i++) {
+                cap_by_budget(byBuyer, buyerGroups[i].first, buyerGroups[i].second);
+            }
+        }
+    );
+
+    std::vector<unsigned int> bySeller(batch.size());
+    std::iota(bySeller.begin(), bySeller.end(), 0);
+    std::sort(
+        bySeller.begin(), bySeller.end(),
+        [this](unsigned int a, unsigned int b) {
+            const BatchOrder& x = batch[a];
+            const BatchOrder& y = batch[b];
+            if (x.seller->get_id() != y.seller->get_id()) {
+                return x.seller->get_id() < y.seller->get_id();
+            }
+            if (x.offerKey != y.offerKey) {
+                return x.offerKey < y.offerKey;
+            }
+            if (x.offer.index != y.offer.index) {
+                return x.offer.index < y.offer.index;
+            }
+            if (x.buyer->get_id() != y.buyer->get_id()) {
+                return x.buyer->get_id() < y.buyer->get_id();
+            }
+            return a < b;
+        }
+    );
+    auto sellerGroups = group_by(bySeller, [](const BatchOrder& o) { return o.seller; });
+    run(
+        sellerGroups.size(),
+        [&](unsigned int startIdx, unsigned int endIdx) {
+            for (unsigned int i = startIdx; i < endIdx; i++) {
+                ration(bySeller, sellerGroups[i].first, sellerGroups[i].second);
+            }
+        }
+    );
+
+    run(
+        buyerGroups.size(),
+        [&](unsigned int startIdx, unsigned int endIdx) {
+            for (unsigned int i = startIdx; i < endIdx; i++) {
+                settle_buyer(byBuyer, buyerGroups[i].first, buyerGroups[i].second);
+            }
+        }
+    );
+    batch.clear();
+
+    for (auto handle : toWithdraw) {
+        Offer* offer = market.get(handle);
+        if (offer == nullptr) {
+            continue;
+        }
+        unsigned int amountLeft = offer->amountLeft.exchange(0);
+        if (amountLeft > 0) {
+            offer->offerer->release_committed(*offer, amountLeft);
+            offer->offerer->economy->record_withdrawal(*offer, amountLeft);
+            offer->offerer->economy->retire_offer(handle);
+        }
+    }
+}
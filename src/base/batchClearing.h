@@ -0,0 +1,77 @@
+#ifndef BATCH_CLEARING_H
+#define BATCH_CLEARING_H
+
+#include <cstdint>
+#include <mutex>
+#include <utility>
+#include <vector>
+#include "slotMap.h"
+
+
+class Agent;
+class Offer;
+class ThreadPool;
+template <typename T> struct Order;
+
+
+class BatchClearing {
+    /**
+     * Collects goods orders during a decision phase & executes them all at once afterwards.
+     *
+     * Clearing runs in three passes, each split into groups that touch disjoint agents,
+     * so every pass can run on the thread pool without taking any agent's lock:
+     *  1. per buyer: each order is capped at what the buyer can still afford, in offer order
+     *  2. per seller: each offer is capped at what the seller's inventory can still cover;
+     *     if demand exceeds supply, units are rationed in proportion to the amounts requested,
+     *     with leftover units going to the largest remainders (ties to the lower agent id);
+     *     the seller is paid & gives up its goods
+     *  3. per buyer: the buyer pays for & receives the units it was allotted
+     *
+     * The result depends only on the set of orders, not on the order they arrived in.
+     * Offer withdrawals requested during the phase are applied after clearing,
+     * so orders can still be filled from offers their sellers replaced in the same phase.
+     */
+public:
+    BatchClearing(SlotMap<Offer>& market);
+
+    // thread safe
+    void add_orders(Agent* buyer, const std::vector<Order<Offer>>& orders);
+    void add_withdrawal(Handle<Offer> offer);
+
+    // fills as many of the collected orders as possible, then applies withdrawals
+    // threadPool may be nullptr, in which case everything runs on the calling thread
+    void clear(ThreadPool* threadPool);
+
+    unsigned int get_numPending() const;
+
+private:
+    struct BatchOrder {
+        Agent* buyer;
+        Agent* seller;
+        Handle<Offer> offer;
+        std::uint64_t offerKey;  // orders are sorted by key so the result doesn't depend on slot order
+        unsigned int amount;  // amount requested, then amount the buyer can afford
+        unsigned int filled = 0;
+    };
+
+    // splits batch, which must be sorted so that equal keys are adjacent, into [begin, end) runs of equal keys
+    template <typename Key>
+    std::vector<std::pair<unsigned int, unsigned int>> group_by(
+        const std::vector<unsigned int>& idx, Key key
+    ) const;
+
+    void cap_by_budget(const std::vector<unsigned int>& idx, unsigned int begin, unsigned int end);
+    void ration(const std::vector<unsigned int>& idx, unsigned int begin, unsigned int end);
+    void settle_buyer(const std::vector<unsigned int>& idx, unsigned int begin, unsigned int end);
+
+    SlotMap<Offer>& market;
+
+    // orders & withdrawals collected since the last clearing pass
+    std::vector<BatchOrder> orders;
+    std::vector<Handle<Offer>> withdrawals;
+    // orders being cleared; only touched inside clear, which must not run concurrently with itself
+    std::vector<BatchOrder> batch;
+    mutable std::mutex mutex;
+};
+
+#endif
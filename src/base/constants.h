@@ -10,6 +10,8 @@ namespace constants {
     const double largeNumber = 1e8;
     const bool multithreaded = true;
     const unsigned int numThreads = std::thread::hardware_concurrency();
+    // markets & agents' offer lists are only swept once more than this fraction of their offers are dead
+    const double maxTombstoneRatio = 0.25;
     
 }
 
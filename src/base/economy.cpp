@@ -1,7 +1,16 @@
 #include "base.h"
 
-Economy::Economy(std::vector<std::string> goods) : goods(goods), numGoods(goods.size()) {
-    rng = util::get_rng();
+// streams reserved for the economy itself; agents' streams are indexed by their ids
+const std::uint64_t SETUP_STREAM = std::uint64_t(1) << 63;
+const std::uint64_t SHUFFLE_STREAM = SETUP_STREAM + 1;
+
+Economy::Economy(
+    std::vector<std::string> goods
+) : goods(goods), numGoods(goods.size()), batchClearing(market), laborMatching(jobMarket) {
+    // a library built for a fixed number of goods can only run economies with that many
+    assert(NumGoods == Eigen::Dynamic || numGoods == NumGoods);
+    orderBooks.push_back(std::unique_ptr<OrderBook>(new OrderBook(market, numGoods)));
+    set_seed(util::get_seed());
 }
 
 std::shared_ptr<Person> Economy::add_person() {
@@ -11,8 +20,16 @@ std::shared_ptr<Person> Economy::add_person() {
 void Economy::add_agent(std::shared_ptr<Person> person) {
     std::lock_guard<std::mutex> lock(mutex);
     assert(person->get_economy() == this);
+    person->id = persons.size() + firms.size();
+    person->region = person->id % numRegions;
+    if (person->time == time) {
+        numCaughtUp.fetch_add(1, std::memory_order_relaxed);
+    }
     persons.push_back(person);
     persons_weak.push_back(std::weak_ptr<Person>(person));
+    if (stateStore != nullptr) {
+        stateStore->add_agent(person.get());
+    }
 }
 
 std::shared_ptr<Firm> Economy::add_firm() {
@@ -22,14 +39,138 @@ std::shared_ptr<Firm> Economy::add_firm() {
 void Economy::add_agent(std::shared_ptr<Firm> firm) {
     std::lock_guard<std::mutex> lock(mutex);
     assert(firm->get_economy() == this);
+    firm->id = persons.size() + firms.size();
+    firm->region = firm->id % numRegions;
+    if (firm->time == time) {
+        numCaughtUp.fetch_add(1, std::memory_order_relaxed);
+    }
     firms.push_back(firm);
     firms_weak.push_back(std::weak_ptr<Firm>(firm));
+    if (stateStore != nullptr) {
+        stateStore->add_agent(firm.get());
+    }
+}
+
+bool Economy::enable_ledger(const std::string& path) {
+    disable_ledger();
+    std::unique_ptr<Ledger> newLedger(new Ledger(path, numGoods));
+    if (!newLedger->good()) {
+        return false;
+    }
+    ledger = std::move(newLedger);
+    return true;
+}
+
+void Economy::disable_ledger() {
+    if (ledger != nullptr) {
+        ledger->end_step(get_time());
+        ledger.reset();
+    }
+}
+
+Ledger* Economy::get_ledger() const { return ledger.get(); }
+
+const MarketStats* Economy::get_marketStats() const { return marketStats.get(); }
+
+void Economy::enable_marketStats() {
+    if (marketStats != nullptr) {
+        return;
+    }
+    marketStats = std::unique_ptr<MarketStats>(new MarketStats(numGoods));
+    recount_marketDepth();
+}
+
+void Economy::recount_marketDepth() {
+    if (marketStats == nullptr) {
+        return;
+    }
+    Eigen::ArrayXd depth = Eigen::ArrayXd::Zero(numGoods);
+    market.for_each(
+        [&](OfferHandle, const Offer& offer) {
+            depth += offer.quantities * offer.amountLeft;
+        }
+    );
+    marketStats->reset_depth(depth);
+}
+
+void Economy::record_fill(const Agent* buyer, const Offer& offer, unsigned int units) {
+    if (ledger != nullptr) {
+        ledger->record(
+            Ledger::Kind::Goods, get_time(), buyer->get_id(), offer.offerer->get_id(), units,
+            offer.key, offer.price, 0.0, offer.quantities.data()
+        );
+    }
+    if (marketStats != nullptr) {
+        marketStats->record_fill(offer.quantities, offer.price, units);
+    }
+}
+
+void Economy::record_hire(const Person* person, const JobOffer& jobOffer, unsigned int units) {
+    if (ledger != nullptr) {
+        ledger->record(
+            Ledger::Kind::Labor, get_time(), jobOffer.offerer->get_id(), person->get_id(), units,
+            jobOffer.key, jobOffer.wage, jobOffer.labor, nullptr
+        );
+    }
+    if (marketStats != nullptr) {
+        marketStats->record_hire(jobOffer.wage, jobOffer.labor, units);
+    }
+}
+
+void Economy::record_withdrawal(const Offer& offer, unsigned int units) {
+    if (marketStats != nullptr) {
+        marketStats->record_withdrawal(offer.quantities, units);
+    }
 }
 
 const std::string& Economy::get_name_for_good_id(unsigned int id) const {
     return goods[id];
 }
 
+void Economy::enable_stateStore() {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (stateStore != nullptr) {
+        return;
+    }
+    stateStore = std::unique_ptr<AgentStateStore>(new AgentStateStore(numGoods));
+    for (auto person : persons) {
+        stateStore->add_agent(person.get());
+    }
+    for (auto firm : firms) {
+        stateStore->add_agent(firm.get());
+    }
+}
+
+const AgentStateStore* Economy::get_stateStore() const { return stateStore.get(); }
+
+Eigen::ArrayXd Economy::get_total_inventory() const {
+    if (stateStore != nullptr) {
+        return stateStore->get_total_inventory();
+    }
+    Eigen::ArrayXd total = Eigen::ArrayXd::Zero(numGoods);
+    for (auto person : persons) {
+        total += person->get_inventory();
+    }
+    for (auto firm : firms) {
+        total += firm->get_inventory();
+    }
+    return total;
+}
+
+double Economy::get_total_money() const {
+    if (stateStore != nullptr) {
+        return stateStore->get_total_money();
+    }
+    double total = 0.0;
+    for (auto person : persons) {
+        total += person->get_money();
+    }
+    for (auto firm : firms) {
+        total += firm->get_money();
+    }
+    return total;
+}
+
 const std::vector<std::weak_ptr<Person>>& Economy::get_persons() const {
     return persons_weak;
 }
@@ -42,88 +183,417 @@ const std::vector<std::string>& Economy::get_goods() const { return goods; }
 
 unsigned int Economy::get_numGoods() const { return numGoods; }
 
-const std::vector<std::weak_ptr<const Offer>>& Economy::get_market() const { return market; }
+const SlotMap<Offer>& Economy::get_market() const { return market; }
 
-const std::vector<std::weak_ptr<const JobOffer>>& Economy::get_jobMarket() const { return jobMarket; }
+const SlotMap<JobOffer>& Economy::get_jobMarket() const { return jobMarket; }
 
-std::default_random_engine Economy::get_rng() const { return rng; }
+const MarketSnapshot<Offer>& Economy::get_offerSnapshot() const { return offerSnapshot; }
 
+const MarketSnapshot<JobOffer>& Economy::get_jobOfferSnapshot() const { return jobOfferSnapshot; }
 
-void Economy::add_offer(std::weak_ptr<const Offer> offer) {
-    std::lock_guard<std::mutex> lock(mutex);
-    market.push_back(offer);
+const Offer* Economy::get_offer(OfferHandle offer) const { return market.get(offer); }
+
+const JobOffer* Economy::get_jobOffer(JobOfferHandle jobOffer) const { return jobMarket.get(jobOffer); }
+
+OrderBook& Economy::get_orderBook(unsigned int region) { return *orderBooks[region]; }
+
+void Economy::set_seed(std::uint64_t seed) {
+    this->seed = seed;
+    rng = util::Philox(seed, SETUP_STREAM, 0);
+}
+
+std::uint64_t Economy::get_seed() const { return seed; }
+
+util::Philox& Economy::get_rng() { return rng; }
+
+util::Philox Economy::get_rng(unsigned int agentId, unsigned int time) const {
+    return util::Philox(seed, agentId, time);
+}
+
+std::shared_ptr<ThreadPool> Economy::get_threadPool() {
+    if (threadPool == nullptr) {
+        threadPool = std::make_shared<ThreadPool>(constants::numThreads);
+    }
+    return threadPool;
+}
+
+void Economy::set_numThreads(unsigned int numThreads) {
+    threadPool = std::make_shared<ThreadPool>(numThreads);
+}
+
+void Economy::set_threadPool(std::shared_ptr<ThreadPool> threadPool) {
+    this->threadPool = threadPool;
+}
+
+
+void Economy::set_lockFreeOffers(bool lockFreeOffers) {
+    this->lockFreeOffers = lockFreeOffers;
 }
-void Economy::add_jobOffer(std::weak_ptr<const JobOffer> jobOffer) {
+
+bool Economy::get_lockFreeOffers() const { return lockFreeOffers && !batchedClearing; }
+
+void Economy::set_batchedClearing(bool batchedClearing) {
+    this->batchedClearing = batchedClearing;
+}
+
+bool Economy::get_batchedClearing() const { return batchedClearing; }
+
+
+bool Economy::set_numRegions(unsigned int numRegions) {
     std::lock_guard<std::mutex> lock(mutex);
-    jobMarket.push_back(jobOffer);
+    if (
+        numRegions == 0 || numRegions > SlotMap<Offer>::MAX_SHARDS
+        || market.size() > 0 || jobMarket.size() > 0
+    ) {
+        return false;
+    }
+    this->numRegions = numRegions;
+    market.set_numShards(numRegions);
+    jobMarket.set_numShards(numRegions);
+    orderBooks.clear();
+    for (unsigned int i = 0; i < numRegions; i++) {
+        orderBooks.push_back(std::unique_ptr<OrderBook>(new OrderBook(market, numGoods)));
+    }
+    for (auto person : persons) {
+        person->region = person->id % numRegions;
+    }
+    for (auto firm : firms) {
+        firm->region = firm->id % numRegions;
+    }
+    return true;
 }
 
+unsigned int Economy::get_numRegions() const { return numRegions; }
 
-template <typename A>
-void run_agents_(
-    const std::vector<std::shared_ptr<A>>* const agents,
-    unsigned int startIdx, unsigned int endIdx
+void Economy::set_region(Agent* agent, unsigned int region) {
+    assert(agent->get_economy() == this && region < numRegions);
+    agent->region = region;
+}
+
+void Economy::set_crossRegionTrade(bool crossRegionTrade) {
+    this->crossRegionTrade = crossRegionTrade;
+}
+
+bool Economy::get_crossRegionTrade() const { return crossRegionTrade; }
+
+bool Economy::can_trade(const Agent* buyer, const Agent* seller) const {
+    return crossRegionTrade || buyer->region == seller->region;
+}
+
+
+void Economy::retire_offer(OfferHandle handle) {
+    const Offer* offer = market.get(handle);
+    if (offer == nullptr) {
+        return;
+    }
+    unsigned int region = SlotMap<Offer>::get_shard(handle);
+    orderBooks[region]->remove_offer(handle);
+    market.add_tombstone(region);
+    offer->offerer->numRetiredOffers++;
+}
+
+void Economy::retire_jobOffer(JobOfferHandle handle) {
+    const JobOffer* jobOffer = jobMarket.get(handle);
+    if (jobOffer == nullptr) {
+        return;
+    }
+    jobMarket.add_tombstone(SlotMap<JobOffer>::get_shard(handle));
+    static_cast<Firm*>(jobOffer->offerer)->numRetiredJobOffers++;
+}
+
+
+OfferHandle Economy::add_offer(const Offer& offer) {
+    // neither the SlotMap nor the order book takes a lock here, save for a thread's first post to them
+    // & the SlotMap reserving a new batch of slots
+    OfferHandle handle = market.insert(offer, offer.offerer->region);
+    if (offer.is_available()) {
+        orderBooks[offer.offerer->region]->add_offer(handle);
+        if (marketStats != nullptr) {
+            marketStats->record_post(offer.quantities, offer.amountLeft);
+        }
+    }
+    else {
+        retire_offer(handle);
+    }
+    return handle;
+}
+JobOfferHandle Economy::add_jobOffer(const JobOffer& jobOffer) {
+    JobOfferHandle handle = jobMarket.insert(jobOffer, jobOffer.offerer->region);
+    if (!jobOffer.is_available()) {
+        retire_jobOffer(handle);
+    }
+    return handle;
+}
+
+OfferHandle Economy::add_offer(
+    Agent* offerer,
+    unsigned int amount_available,
+    const Eigen::Ref<const Eigen::ArrayXd>& quantities,
+    double price,
+    std::uint64_t key
 ) {
-    for (unsigned int i = startIdx; i < endIdx; i++) {
-        (*agents)[i]->time_step();
+    OfferHandle handle = market.emplace(
+        [&](Offer& offer) { offer.assign(offerer, amount_available, quantities, price, key); },
+        offerer->region
+    );
+    if (amount_available > 0) {
+        orderBooks[offerer->region]->add_offer(handle);
+        if (marketStats != nullptr) {
+            marketStats->record_post(quantities, amount_available);
+        }
     }
+    else {
+        retire_offer(handle);
+    }
+    return handle;
+}
+JobOfferHandle Economy::add_jobOffer(
+    Firm* offerer,
+    unsigned int amount_available,
+    double labor,
+    double wage,
+    std::uint64_t key
+) {
+    JobOfferHandle handle = jobMarket.emplace(
+        [&](JobOffer& jobOffer) { jobOffer.assign(offerer, amount_available, labor, wage, key); },
+        offerer->region
+    );
+    if (amount_available == 0) {
+        retire_jobOffer(handle);
+    }
+    return handle;
 }
 
+
 template <typename A>
-void run_agents(const std::vector<std::shared_ptr<A>>* const agents) {
-    // runs time_step for a vector of agents, multithreaded
-    std::vector<unsigned int> indices = util::get_indices_for_multithreading(agents->size());
-    std::vector<std::thread> threads;
-    threads.reserve(constants::numThreads);
-    for (unsigned int i = 0; i < constants::numThreads; i++) {
-        if (indices[i] != indices[i+1]) {
-            threads.push_back(
-                std::thread(
-                    run_agents_<A>,
-                    agents,
-                    indices[i],
-                    indices[i+1]
-                )
-            );
-        }
+std::vector<unsigned int> sort_by_region(std::vector<std::shared_ptr<A>>& agents, unsigned int numRegions) {
+    // keeps the shuffled order within each region; returns where each region starts, plus one past the end
+    std::stable_sort(
+        agents.begin(), agents.end(),
+        [](const std::shared_ptr<A>& a, const std::shared_ptr<A>& b) { return a->get_region() < b->get_region(); }
+    );
+    std::vector<unsigned int> regionStart(numRegions + 1, 0);
+    for (const auto& agent : agents) {
+        regionStart[agent->get_region() + 1]++;
     }
-    for (unsigned int i = 0; i < threads.size(); i++) {
-        threads[i].join();
+    for (unsigned int i = 1; i <= numRegions; i++) {
+        regionStart[i] += regionStart[i-1];
     }
+    return regionStart;
 }
 
 bool Economy::time_step() {
+    if (!begin_step()) {
+        return false;
+    }
+    step_agents();
+    end_step();
+    return true;
+}
+
+void Economy::step_agents() {
+    std::shared_ptr<ThreadPool> pool = constants::multithreaded ? get_threadPool() : nullptr;
+    for (Phase phase : {Phase::CheckOffers, Phase::Persons, Phase::Firms}) {
+        unsigned int numUnits = get_numPhaseUnits(phase);
+        auto run = [this, phase](unsigned int startIdx, unsigned int endIdx) { run_phase(phase, startIdx, endIdx); };
+        if (pool != nullptr) {
+            pool->run(numUnits, run);
+        }
+        else {
+            run(0, numUnits);
+        }
+        if (phase != Phase::CheckOffers) {
+            end_phase(pool.get());
+        }
+    }
+}
+
+unsigned int Economy::get_numPhaseUnits(Phase phase) const {
+    switch (phase) {
+        case Phase::CheckOffers:
+            return persons.size() + firms.size();
+        case Phase::Persons:
+            return (numRegions > 1) ? numRegions : persons.size();
+        case Phase::Firms:
+            return (numRegions > 1) ? numRegions : firms.size();
+    }
+    return 0;
+}
+
+template <typename A>
+void run_agents(const std::vector<std::shared_ptr<A>>& agents, unsigned int startIdx, unsigned int endIdx) {
+    for (unsigned int i = startIdx; i < endIdx; i++) {
+        agents[i]->time_step();
+    }
+}
+
+void Economy::run_phase(Phase phase, unsigned int startIdx, unsigned int endIdx) {
+    switch (phase) {
+        case Phase::CheckOffers:
+            check_offers(startIdx, endIdx);
+            break;
+        case Phase::Persons:
+            if (numRegions > 1) {
+                run_agents(persons, personsRegionStart[startIdx], personsRegionStart[endIdx]);
+            }
+            else {
+                run_agents(persons, startIdx, endIdx);
+            }
+            break;
+        case Phase::Firms:
+            if (numRegions > 1) {
+                run_agents(firms, firmsRegionStart[startIdx], firmsRegionStart[endIdx]);
+            }
+            else {
+                run_agents(firms, startIdx, endIdx);
+            }
+            break;
+    }
+}
+
+bool Economy::begin_step() {
     // check that all agents have caught up before stepping
-    for (auto person : persons) {
-        if (person->get_time() != time) {
-            return false;
+    if (numCaughtUp.load(std::memory_order_acquire) != persons.size() + firms.size()) {
+        return false;
+    }
+    numCaughtUp.store(0, std::memory_order_relaxed);
+    time.fetch_add(1, std::memory_order_release);
+    // e.g. offers posted while setting up, or restored from a snapshot
+    list_pending_offers();
+    offerSnapshot.update(market, get_time());
+    jobOfferSnapshot.update(jobMarket, get_time());
+    // agents are shuffled before they step
+    util::Philox shuffleRng(seed, SHUFFLE_STREAM, time);
+    std::shuffle(std::begin(persons), std::end(persons), shuffleRng);
+    std::shuffle(std::begin(firms), std::end(firms), shuffleRng);
+    if (numRegions > 1) {
+        personsRegionStart = sort_by_region(persons, numRegions);
+        firmsRegionStart = sort_by_region(firms, numRegions);
+    }
+    return true;
+}
+
+void Economy::check_offers(unsigned int startIdx, unsigned int endIdx) {
+    unsigned int numPersons = persons.size();
+    std::vector<Agent*> agents;
+    std::vector<OfferHandle> handles;
+    std::vector<unsigned int> offerStart(1, 0);
+    for (unsigned int i = startIdx; i < endIdx; i++) {
+        Agent* agent = (i < numPersons) ? static_cast<Agent*>(persons[i].get()) : firms[i - numPersons].get();
+        // as in check_my_offers, agents that can still cover everything they've committed are left alone
+        if ((agent->committedInventory <= agent->inventory).all()) {
+            continue;
+        }
+        agents.push_back(agent);
+        for (auto handle : agent->myOffers) {
+            if (market.get(handle) != nullptr) {
+                handles.push_back(handle);
+            }
         }
+        offerStart.push_back(handles.size());
     }
-    for (auto firm : firms) {
-        if (firm->get_time() != time) {
-            return false;
+    if (agents.empty()) {
+        return;
+    }
+    Eigen::ArrayXXd inventories(numGoods, agents.size());
+    Eigen::ArrayXXd quantities(numGoods, handles.size());
+    std::vector<unsigned int> amounts(handles.size());
+    for (unsigned int i = 0; i < agents.size(); i++) {
+        inventories.col(i) = agents[i]->inventory;
+    }
+    for (unsigned int i = 0; i < agents.size(); i++) {
+        for (unsigned int j = offerStart[i]; j < offerStart[i+1]; j++) {
+            const Offer* offer = market.get(handles[j]);
+            quantities.col(j) = offer->quantities;
+            amounts[j] = offer->amountLeft;
+            // units sold but not settled for yet are still in inventory, but can't cover anything else
+            inventories.col(i) -= offer->quantities * offer->get_amountPending();
         }
     }
-    time++;
-    // now actually step
-    // agents are shuffled first
-    std::shuffle(std::begin(persons), std::end(persons), rng);
-    std::shuffle(std::begin(firms), std::end(firms), rng);
-    // persons go first, then firms
-    if (constants::multithreaded) {
-        run_agents(&persons);
-        run_agents(&firms);
+    util::trim_to_inventory(inventories, quantities, amounts.data(), offerStart);
+    for (unsigned int i = 0; i < agents.size(); i++) {
+        Agent* agent = agents[i];
+        agent->committedInventory.setZero();
+        for (unsigned int j = offerStart[i]; j < offerStart[i+1]; j++) {
+            Offer* offer = market.get(handles[j]);
+            unsigned int amountBefore = offer->amountLeft;
+            unsigned int removed = 0;
+            offer->limit_amountLeft(amounts[j], removed);
+            record_withdrawal(*offer, removed);
+            if (amountBefore > 0 && offer->amountLeft == 0) {
+                retire_offer(handles[j]);
+            }
+            agent->committedInventory += offer->quantities * offer->get_amountCommitted();
+        }
     }
-    else {
+}
+
+void Economy::recount_caughtUp() {
+    unsigned int count = 0;
+    for (auto person : persons) {
+        count += (person->get_time() == time);
+    }
+    for (auto firm : firms) {
+        count += (firm->get_time() == time);
+    }
+    numCaughtUp.store(count, std::memory_order_release);
+}
+
+void Economy::end_phase(ThreadPool* threadPool) {
+    list_pending_offers();
+    if (batchedClearing) {
+        // wages are paid first, so buyers can spend what they earned this phase
+        laborMatching.clear(threadPool);
+        batchClearing.clear(threadPool);
+    }
+}
+
+void Economy::list_pending_offers() {
+    for (auto& orderBook : orderBooks) {
+        orderBook->list_pending();
+    }
+}
+
+void Economy::end_step() {
+    // anything posted after the last phase, so compaction & the statistics see it
+    list_pending_offers();
+    if (get_lockFreeOffers()) {
+        // settle before flushing, since sold-out offers still owe their offerers
         for (auto person : persons) {
-            person->time_step();
+            person->settle_offers();
         }
         for (auto firm : firms) {
-            firm->time_step();
+            firm->settle_offers();
         }
     }
-    util::flush(market);
-    util::flush(jobMarket);
+    // sold out & withdrawn offers stay in the markets as tombstones until enough of a market is dead,
+    // so the cost of sweeping is proportional to churn rather than to the size of the market
+    if (market.needs_compaction(constants::maxTombstoneRatio)) {
+        // the order books have to drop their listings before their slots can be reused
+        for (auto& orderBook : orderBooks) {
+            orderBook->flush();
+        }
+        market.erase_if([](const Offer& offer) { return !offer.is_available(); });
+    }
+    if (jobMarket.needs_compaction(constants::maxTombstoneRatio)) {
+        jobMarket.erase_if([](const JobOffer& offer) { return !offer.is_available(); });
+    }
+    if (ledger != nullptr) {
+        ledger->end_step(get_time());
+    }
+    if (marketStats != nullptr) {
+        // the order books already keep each good's cheapest listing at the front
+        Eigen::ArrayXd bestAsk = Eigen::ArrayXd::Constant(numGoods, -1.0);
+        for (auto& orderBook : orderBooks) {
+            for (unsigned int i = 0; i < numGoods; i++) {
+                double price = orderBook->best_price(i);
+                if (price >= 0 && (bestAsk(i) < 0 || price < bestAsk(i))) {
+                    bestAsk(i) = price;
+                }
+            }
+        }
+        marketStats->end_step(get_time(), bestAsk);
+    }
     if (constants::verbose >= 3) {
         print_summary();
     }
@@ -135,11 +605,10 @@ bool Economy::time_step() {
             firm->print_summary();
         }
     }
-    return true;
 }
 
 unsigned int Economy::get_time() const {
-    return time;
+    return time.load(std::memory_order_acquire);
 }
 
 
@@ -152,24 +621,32 @@ void Economy::print_summary() const {
     std::cout << "\n----------\n"
         << "Memory ID: " << this << " (" << get_typename() << ")\n"
         << "----------\n";
-    std::cout << "Time: " << time << "\n\n";
+    std::cout << "Time: " << get_time() << "\n";
+    std::cout << "Total money: " << get_total_money()
+        << " ~ total inventory: " << get_total_inventory().transpose() << "\n\n";
     std::cout << "Offers:\n";
-    for (auto offer_ : market) {
-        auto offer = offer_.lock();
-        if (offer == nullptr) { continue; }
-        std::cout << "Offerer: " << offer->offerer.lock() << " ~ amt left: " << offer->amountLeft
-            << " ~ amt taken: " << offer->amountTaken
-            << "\n price: " << offer->price << " ~ quantitities " << offer->quantities.transpose()
-            << '\n';
-    }
+    market.for_each(
+        [](OfferHandle, const Offer& offer) {
+            if (!offer.is_available()) {
+                return;
+            }
+            std::cout << "Offerer: " << offer.offerer << " ~ amt left: " << offer.amountLeft
+                << " ~ amt taken: " << offer.amountTaken
+                << "\n price: " << offer.price << " ~ quantitities " << offer.quantities.transpose()
+                << '\n';
+        }
+    );
     std::cout << "\nJob Offers:\n";
-    for (auto offer_ : jobMarket) {
-        auto offer = offer_.lock();
-        if (offer == nullptr) { continue; }
-        std::cout << "Offerer: " << offer->offerer.lock() << " ~ amt left: " << offer->amountLeft
-            << " ~ amt taken: " << offer->amountTaken
-            << "\n wage: " << offer->wage << " ~ labor " << offer->labor
-            << '\n';
-    }
+    jobMarket.for_each(
+        [](JobOfferHandle, const JobOffer& offer) {
+            if (!offer.is_available()) {
+                return;
+            }
+            std::cout << "Offerer: " << offer.offerer << " ~ amt left: " << offer.amountLeft
+                << " ~ amt taken: " << offer.amountTaken
+                << "\n wage: " << offer.wage << " ~ labor " << offer.labor
+                << '\n';
+        }
+    );
     std::cout << "\n\n";
 }
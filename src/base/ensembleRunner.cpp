@@ -0,0 +1,147 @@
+#include <assert.h>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include "ensembleRunner.h"
+#include "base.h"
+#include "threadPool.h"
+
+
+EnsembleRunner::EnsembleRunner(
+) : EnsembleRunner(std::make_shared<ThreadPool>(constants::numThreads)) {}
+
+EnsembleRunner::EnsembleRunner(
+    std::shared_ptr<ThreadPool> threadPool
+) : threadPool(threadPool) {}
+
+
+unsigned int EnsembleRunner::add_economy(std::shared_ptr<Economy> economy) {
+    assert(economies.empty() || economy->get_numGoods() == economies[0]->get_numGoods());
+    economy->set_threadPool(threadPool);
+    economies.push_back(economy);
+    return economies.size() - 1;
+}
+
+
+bool EnsembleRunner::time_step() {
+    std::vector<Economy*> stepping;
+    for (auto& economy : economies) {
+        if (economy->begin_step()) {
+            stepping.push_back(economy.get());
+        }
+    }
+
+    // one pool job per phase covering the work units of every economy (see Economy::run_phase),
+    // so each economy's phases are split up exactly as they would be if it stepped on its own
+    std::vector<unsigned int> unitStart(stepping.size() + 1, 0);
+    for (Economy::Phase phase : {Economy::Phase::CheckOffers, Economy::Phase::Persons, Economy::Phase::Firms}) {
+        for (unsigned int k = 0; k < stepping.size(); k++) {
+            unitStart[k+1] = unitStart[k] + stepping[k]->get_numPhaseUnits(phase);
+        }
+        threadPool->run(
+            unitStart.back(),
+            [&stepping, &unitStart, phase](unsigned int startIdx, unsigned int endIdx) {
+                // the economy holding startIdx, & any after it that the chunk reaches into
+                unsigned int k = std::upper_bound(unitStart.begin(), unitStart.end(), startIdx) - unitStart.begin() - 1;
+                for (; k < stepping.size() && unitStart[k] < endIdx; k++) {
+                    unsigned int lo = std::max(startIdx, unitStart[k]);
+                    unsigned int hi = std::min(endIdx, unitStart[k+1]);
+                    if (lo < hi) {
+                        stepping[k]->run_phase(phase, lo - unitStart[k], hi - unitStart[k]);
+                    }
+                }
+            }
+        );
+        if (phase != Economy::Phase::CheckOffers) {
+            for (auto economy : stepping) {
+                economy->end_phase(threadPool.get());
+            }
+        }
+    }
+
+    for (auto economy : stepping) {
+        economy->end_step();
+    }
+    update_stats();
+    return stepping.size() == economies.size();
+}
+
+unsigned int EnsembleRunner::run(unsigned int numSteps) {
+    for (unsigned int t = 0; t < numSteps; t++) {
+        if (!time_step()) {
+            return t;
+        }
+    }
+    return numSteps;
+}
+
+
+void EnsembleRunner::update_stats() {
+    unsigned int n = economies.size();
+    unsigned int numGoods = (n > 0) ? economies[0]->get_numGoods() : 0;
+    stats = EnsembleStats();
+    stats.numEconomies = n;
+    stats.meanInventory = Eigen::ArrayXd::Zero(numGoods);
+    stats.stdInventory = Eigen::ArrayXd::Zero(numGoods);
+    stats.meanBestPrice = Eigen::ArrayXd::Zero(numGoods);
+    if (n == 0) {
+        return;
+    }
+
+    std::vector<Eigen::ArrayXd> inventories;
+    Eigen::ArrayXd numPriced = Eigen::ArrayXd::Zero(numGoods);
+    for (auto& economy : economies) {
+        stats.time = std::max(stats.time, economy->get_time());
+        stats.meanMoney += economy->get_total_money();
+        // not counting offers that are only waiting to be swept
+        stats.meanNumOffers += economy->get_market().size() - economy->get_market().get_numTombstones();
+        stats.meanNumJobOffers += economy->get_jobMarket().size() - economy->get_jobMarket().get_numTombstones();
+        inventories.push_back(economy->get_total_inventory());
+        stats.meanInventory += inventories.back();
+        for (unsigned int i = 0; i < numGoods; i++) {
+            // cheapest across regions
+            double price = -1.0;
+            for (unsigned int r = 0; r < economy->get_numRegions(); r++) {
+                double regionPrice = economy->get_orderBook(r).best_price(i);
+                if (regionPrice >= 0 && (price < 0 || regionPrice < price)) {
+                    price = regionPrice;
+                }
+            }
+            if (price >= 0) {
+                stats.meanBestPrice(i) += price;
+                numPriced(i)++;
+            }
+        }
+    }
+    stats.meanMoney /= n;
+    stats.meanNumOffers /= n;
+    stats.meanNumJobOffers /= n;
+    stats.meanInventory /= n;
+    // two passes, since totals are large compared to their spread across economies
+    for (const auto& inventory : inventories) {
+        stats.stdInventory += (inventory - stats.meanInventory).square();
+    }
+    stats.stdInventory = (stats.stdInventory / n).sqrt();
+    for (unsigned int i = 0; i < numGoods; i++) {
+        stats.meanBestPrice(i) = (
+            (numPriced(i) > 0) ? stats.meanBestPrice(i) / numPriced(i) : std::numeric_limits<double>::quiet_NaN()
+        );
+    }
+}
+
+
+const EnsembleStats& EnsembleRunner::get_stats() const {
+    return stats;
+}
+
+std::shared_ptr<Economy> EnsembleRunner::get_economy(unsigned int idx) const {
+    return economies[idx];
+}
+
+unsigned int EnsembleRunner::get_numEconomies() const {
+    return economies.size();
+}
+
+std::shared_ptr<ThreadPool> EnsembleRunner::get_threadPool() const {
+    return threadPool;
+}
@@ -0,0 +1,73 @@
+#ifndef ENSEMBLE_RUNNER_H
+#define ENSEMBLE_RUNNER_H
+
+#include <memory>
+#include <vector>
+#include <Eigen/Dense>
+
+
+class Economy;
+class ThreadPool;
+
+
+struct EnsembleStats {
+    // statistics across the economies of an ensemble at one time step
+    unsigned int time = 0;
+    unsigned int numEconomies = 0;
+    double meanMoney = 0.0;  // mean over economies of total money
+    double meanNumOffers = 0.0;
+    double meanNumJobOffers = 0.0;
+    Eigen::ArrayXd meanInventory;  // mean over economies of total inventory, per good
+    Eigen::ArrayXd stdInventory;
+    // mean over economies of the best unit price for each good;
+    // economies with no offers for a good are left out, and the mean is NaN if none have any
+    Eigen::ArrayXd meanBestPrice;
+};
+
+
+class EnsembleRunner {
+    /**
+     * Steps many independent economies together on one shared ThreadPool.
+     *
+     * Each economy keeps its own agents, markets, seed & settings; only the threads are shared.
+     * Rather than stepping the economies one after another, every phase of a time step
+     * is run for all economies at once, with the work of all economies handed to the pool as one job.
+     * The work is split up by each economy the same way it would split it itself (see Economy::run_phase):
+     * its offers are checked before persons step, and each of its regions steps on a single thread.
+     * This keeps every thread busy even when each economy on its own is too small to,
+     * and pays for one wake-up & join per phase instead of one per economy.
+     *
+     * Economies are independent, so each one evolves exactly as it would if stepped on its own
+     * (given a fixed seed, results don't depend on what else is in the ensemble).
+     */
+public:
+    // uses a pool of constants::numThreads threads
+    EnsembleRunner();
+    EnsembleRunner(std::shared_ptr<ThreadPool> threadPool);
+
+    // economy is switched over to the ensemble's pool; all economies must have the same number of goods
+    // returns the economy's index in the ensemble
+    unsigned int add_economy(std::shared_ptr<Economy> economy);
+
+    // steps every economy once; returns false if any economy couldn't step
+    // (because some of its agents hadn't caught up), in which case that economy is left as it was
+    bool time_step();
+    // calls time_step numSteps times, stopping early if it fails
+    // returns the number of steps completed
+    unsigned int run(unsigned int numSteps);
+
+    // statistics as of the end of the last time step
+    const EnsembleStats& get_stats() const;
+    std::shared_ptr<Economy> get_economy(unsigned int idx) const;
+    unsigned int get_numEconomies() const;
+    std::shared_ptr<ThreadPool> get_threadPool() const;
+
+private:
+    void update_stats();
+
+    std::shared_ptr<ThreadPool> threadPool;
+    std::vector<std::shared_ptr<Economy>> economies;
+    EnsembleStats stats;
+};
+
+#endif
@@ -4,10 +4,10 @@
 #include "base.h"
 
 Firm::Firm(Economy* economy)
-    : Agent(economy) {}
+    : Agent(economy), laborHired(labor) {}
 
 Firm::Firm(Economy* economy, std::vector<std::shared_ptr<Agent>> owners, Eigen::ArrayXd inventory, double money)
-    : Agent(economy, inventory, money), owners(owners) {}
+    : Agent(economy, inventory, money), owners(owners), laborHired(labor) {}
 
 
 std::string Firm::get_typename() const {
@@ -25,67 +25,72 @@ bool Firm::time_step() {
         return false;
     }
     else {
-        util::print_status(this, "Checking my job offers...");
+        trace::record(3, trace::Event::CheckJobOffers, id, time);
         check_myJobOffers();
         {
             std::lock_guard<std::mutex> lock(myMutex);
-            util::flush(myJobOffers);
+            util::flush_if_stale(myJobOffers, economy->jobMarket, numRetiredJobOffers);
         }
-        util::print_status(this, "Buying goods...");
+        trace::record(3, trace::Event::BuyGoods, id, time);
         buy_goods();
-        util::print_status(this, "Producing...");
+        trace::record(3, trace::Event::Produce, id, time);
         produce();
-        util::print_status(this, "Selling goods...");
+        trace::record(3, trace::Event::SellGoods, id, time);
         sell_goods();
         pay_dividends();
         laborHired = 0.0;
-        util::print_status(this, "Searching for laborers...");
+        trace::record(3, trace::Event::SearchForLaborers, id, time);
         search_for_laborers();
         return true;
     }
 }
 
-void Firm::post_jobOffer(std::shared_ptr<JobOffer> jobOffer) {
+JobOfferHandle Firm::post_jobOffer(const JobOffer& jobOffer) {
+    assert(jobOffer.offerer == this);
+    return post_jobOffer(jobOffer.amountLeft, jobOffer.labor, jobOffer.wage);
+}
+
+JobOfferHandle Firm::post_jobOffer(unsigned int amount_available, double labor, double wage) {
     std::lock_guard<std::mutex> lock(myMutex);
-    assert(jobOffer->offerer.lock() == shared_from_this());
-    economy->add_jobOffer(std::weak_ptr<const JobOffer>(jobOffer));
-    myJobOffers.push_back(jobOffer);
+    std::uint64_t key = (std::uint64_t(id) << 32) | numOffersPosted++;
+    JobOfferHandle handle = economy->add_jobOffer(this, amount_available, labor, wage, key);
+    myJobOffers.push_back(handle);
+    return handle;
+}
+
+JobOffer* Firm::lookup_jobOffer(JobOfferHandle jobOffer) {
+    return economy->jobMarket.get(jobOffer);
 }
 
 
 bool Firm::review_jobOffer_response(
     std::shared_ptr<Person> responder,
-    std::weak_ptr<const JobOffer> jobOffer
+    JobOfferHandle handle
 ) {
-    std::shared_ptr<const JobOffer> jobOffer_ = jobOffer.lock();
-    std::shared_ptr<JobOffer> myCopy = nullptr;
+    JobOffer* jobOffer = nullptr;
     {
         std::lock_guard<std::mutex> lock(myMutex);
-        if (!jobOffer_->is_available()) {
-            util::print_status(this, "Requested offer is not available.");
+        jobOffer = lookup_jobOffer(handle);
+        // check that the job offer is one of this firm's
+        if (jobOffer == nullptr || jobOffer->offerer != this) {
             return false;
         }
-        // check that the offer is in myOffers
-        for (auto myOffer : myJobOffers) {
-            if (myOffer == jobOffer_) {
-                myCopy = myOffer;
-                break;
-            }
-        }
-        if (myCopy == nullptr) {
+        if (!jobOffer->is_available()) {
+            trace::record(3, trace::Event::OfferUnavailable, id, time, handle.index);
             return false;
         }
-        // need to use myCopy from here since it's not const
         // make sure this firm can actually afford to pay the wage
-        if (money < myCopy->wage) {
-            util::print_status(this, "I can't afford to fulfill this offer.");
+        if (money < jobOffer->wage) {
+            trace::record(3, trace::Event::CannotAfford, id, time, handle.index, jobOffer->wage);
             // mark for removal
-            myCopy->amountLeft = 0;
+            if (jobOffer->amountLeft.exchange(0) > 0) {
+                economy->retire_jobOffer(handle);
+            }
             return false;
         }
     }
     // all good, let's go!
-    accept_jobOffer_response(myCopy);
+    accept_jobOffer_response(handle, jobOffer);
     return true;
 }
 
@@ -93,7 +98,12 @@ bool Firm::review_jobOffer_response(
 void Firm::check_myJobOffers() {
     std::lock_guard<std::mutex> lock(myMutex);
     double moneyLeft = money;
-    for (auto offer : myJobOffers) {
+    for (auto handle : myJobOffers) {
+        JobOffer* offer = lookup_jobOffer(handle);
+        // retired offers stay on the market until it's compacted, but mustn't be brought back
+        if (offer == nullptr || !offer->is_available()) {
+            continue;
+        }
         unsigned int amountAble = moneyLeft / offer->wage;
         if (amountAble > offer->amountLeft) {
             offer->amountLeft = amountAble;
@@ -103,11 +113,20 @@ void Firm::check_myJobOffers() {
 }
 
 
-void Firm::accept_jobOffer_response(std::shared_ptr<JobOffer> jobOffer) {
+void Firm::accept_jobOffer_response(JobOfferHandle handle, JobOffer* jobOffer) {
     std::lock_guard<std::mutex> lock(myMutex);
-    util::print_status(this, "Accepting jobOffer response...");
+    trace::record(3, trace::Event::AcceptJobOfferResponse, id, time, handle.index, jobOffer->wage);
     money -= jobOffer->wage;
     laborHired += jobOffer->labor;
-    jobOffer->amountLeft--;
     jobOffer->amountTaken++;
+    if (--jobOffer->amountLeft == 0) {
+        economy->retire_jobOffer(handle);
+    }
+}
+
+void Firm::withdraw_jobOffer(JobOfferHandle handle) {
+    JobOffer* jobOffer = lookup_jobOffer(handle);
+    if (jobOffer != nullptr && jobOffer->amountLeft.exchange(0) > 0) {
+        economy->retire_jobOffer(handle);
+    }
 }
@@ -0,0 +1,25 @@
+#ifndef GOODS_H
+#define GOODS_H
+
+#include <Eigen/Dense>
+
+
+// the number of goods can be fixed when the library is built (the FASTACE_NUM_GOODS CMake option),
+// in which case vectors over goods live inline, without allocating, and loops over them are unrolled;
+// otherwise it's Eigen::Dynamic and an Economy can have any number of goods
+#ifdef FASTACE_NUM_GOODS
+constexpr int NumGoods = FASTACE_NUM_GOODS;
+static_assert(NumGoods > 0, "FASTACE_NUM_GOODS must be positive");
+#else
+constexpr int NumGoods = Eigen::Dynamic;
+#endif
+
+// a vector over N goods, plus Extra more entries (e.g. labor in front of a utility function's inputs)
+template <int N, int Extra = 0>
+using GoodsArray = Eigen::Array<double, (N == Eigen::Dynamic) ? Eigen::Dynamic : N + Extra, 1>;
+
+// inventories & offers' quantities
+// use Goods::Zero(n) rather than Goods(n), which for a single good would mean a value rather than a size
+using Goods = GoodsArray<NumGoods>;
+
+#endif
@@ -0,0 +1,267 @@
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <numeric>
+#include "laborMatching.h"
+#include "base.h"
+
+
+LaborMatching::LaborMatching(SlotMap<JobOffer>& jobMarket) : jobMarket(jobMarket) {}
+
+
+void LaborMatching::add_applications(Person* person, const std::vector<Order<JobOffer>>& newApplications) {
+    std::lock_guard<std::mutex> lock(mutex);
+    unsigned int rank = 0;
+    for (const auto& application : newApplications) {
+        const JobOffer* jobOffer = jobMarket.get(application.offer);
+        if (
+            jobOffer == nullptr || application.amount == 0
+            || !person->economy->can_trade(jobOffer->offerer, person)
+        ) {
+            continue;
+        }
+        applications.push_back(Application{
+            person, static_cast<Firm*>(jobOffer->offerer), application.offer, jobOffer->key, rank++, application.amount
+        });
+    }
+}
+
+unsigned int LaborMatching::get_numPending() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return applications.size();
+}
+
+
+template <typename Key>
+std::vector<std::pair<unsigned int, unsigned int>> LaborMatching::group_by(
+    const std::vector<unsigned int>& idx, Key key
+) const {
+    std::vector<std::pair<unsigned int, unsigned int>> groups;
+    unsigned int begin = 0;
+    for (unsigned int i = 1; i <= idx.size(); i++) {
+        if (i == idx.size() || key(batch[idx[i]]) != key(batch[idx[begin]])) {
+            groups.push_back(std::make_pair(begin, i));
+            begin = i;
+        }
+    }
+    return groups;
+}
+
+
+unsigned int LaborMatching::propose(const std::vector<unsigned int>& idx, unsigned int begin, unsigned int end) {
+    // same check as Person::respond_to_jobOffer, one unit at a time
+    double laborSupplied = batch[idx[begin]].person->laborSupplied;
+    unsigned int numProposed = 0;
+    for (unsigned int i = begin; i < end; i++) {
+        Application& application = batch[idx[i]];
+        application.proposed = 0;
+        if (application.amount == 0) {
+            continue;
+        }
+        const JobOffer* jobOffer = jobMarket.get(application.offer);
+        if (jobOffer == nullptr || !jobOffer->is_available()) {
+            application.amount = 0;
+            continue;
+        }
+        while (application.proposed < application.amount && laborSupplied + jobOffer->labor <= 1) {
+            laborSupplied += jobOffer->labor;
+            application.proposed++;
+        }
+        numProposed += application.proposed;
+    }
+    return numProposed;
+}
+
+
+unsigned int LaborMatching::accept(const std::vector<unsigned int>& idx, unsigned int begin, unsigned int end) {
+    Firm* firm = batch[idx[begin]].firm;
+    double moneyLeft = firm->money;
+    unsigned int numHired = 0;
+    unsigned int offerBegin = begin;
+    while (offerBegin < end) {
+        Handle<JobOffer> handle = batch[idx[offerBegin]].offer;
+        unsigned int offerEnd = offerBegin;
+        unsigned long long demand = 0;
+        while (offerEnd < end && batch[idx[offerEnd]].offer == handle) {
+            demand += batch[idx[offerEnd]].proposed;
+            offerEnd++;
+        }
+        JobOffer* jobOffer = jobMarket.get(handle);
+        unsigned int supply = (jobOffer != nullptr && jobOffer->is_available()) ? jobOffer->amountLeft.load() : 0;
+        bool outOfBudget = false;
+        if (supply > 0) {
+            unsigned int wanted = std::min<unsigned long long>(supply, demand);
+            unsigned int canAfford = util::get_affordable(moneyLeft, jobOffer->wage, wanted);
+            if (canAfford < wanted) {
+                supply = canAfford;
+                outOfBudget = true;
+            }
+        }
+        unsigned int numFilled = 0;
+        if (demand <= supply) {
+            for (unsigned int i = offerBegin; i < offerEnd; i++) {
+                batch[idx[i]].filled = batch[idx[i]].proposed;
+            }
+            numFilled = demand;
+        }
+        else {
+            // proportional rationing by largest remainder; integer arithmetic keeps this exact
+            std::vector<std::pair<unsigned long long, unsigned int>> remainders;
+            for (unsigned int i = offerBegin; i < offerEnd; i++) {
+                Application& application = batch[idx[i]];
+                unsigned long long share = (unsigned long long)supply * application.proposed;
+                application.filled = share / demand;
+                numFilled += application.filled;
+                remainders.push_back(std::make_pair(share % demand, i));
+            }
+            // applications to an offer are sorted by person id, so stable_sort breaks ties by id
+            std::stable_sort(
+                remainders.begin(), remainders.end(),
+                [](const std::pair<unsigned long long, unsigned int>& a, const std::pair<unsigned long long, unsigned int>& b) {
+                    return a.first > b.first;
+                }
+            );
+            for (unsigned int j = 0; numFilled < supply; j++) {
+                batch[idx[remainders[j].second]].filled++;
+                numFilled++;
+            }
+        }
+        // whatever wasn't filled in full was turned down, so the person moves on to its next choices
+        for (unsigned int i = offerBegin; i < offerEnd; i++) {
+            Application& application = batch[idx[i]];
+            application.amount = (application.filled < application.proposed) ? 0 : application.amount - application.filled;
+        }
+        if (numFilled > 0) {
+            moneyLeft -= jobOffer->wage * numFilled;
+            firm->money -= jobOffer->wage * numFilled;
+            firm->laborHired += jobOffer->labor * numFilled;
+            jobOffer->amountTaken += numFilled;
+            if ((jobOffer->amountLeft -= numFilled) == 0) {
+                firm->economy->retire_jobOffer(handle);
+            }
+        }
+        if (outOfBudget && jobOffer->amountLeft.exchange(0) > 0) {
+            trace::record(3, trace::Event::CannotAfford, firm->get_id(), firm->get_time(), handle.index, jobOffer->wage);
+            firm->economy->retire_jobOffer(handle);
+        }
+        numHired += numFilled;
+        offerBegin = offerEnd;
+    }
+    return numHired;
+}
+
+
+void LaborMatching::settle_person(const std::vector<unsigned int>& idx, unsigned int begin, unsigned int end) {
+    Person* person = batch[idx[begin]].person;
+    for (unsigned int i = begin; i < end; i++) {
+        Application& application = batch[idx[i]];
+        if (application.filled == 0) {
+            continue;
+        }
+        const JobOffer* jobOffer = jobMarket.get(application.offer);
+        person->laborSupplied += jobOffer->labor * application.filled;
+        person->money += jobOffer->wage * application.filled;
+        person->economy->record_hire(person, *jobOffer, application.filled);
+        application.filled = 0;
+    }
+}
+
+
+void LaborMatching::clear(ThreadPool* threadPool) {
+    {
+        // release the lock before running any passes, so that no lock is held across ThreadPool::run
+        std::lock_guard<std::mutex> lock(mutex);
+        batch.swap(applications);
+    }
+    if (batch.empty()) {
+        return;
+    }
+    auto run = [threadPool](unsigned int numTasks, const ThreadPool::Task& task) {
+        if (threadPool != nullptr) {
+            threadPool->run(numTasks, task);
+        }
+        else {
+            task(0, numTasks);
+        }
+    };
+
+    // each pass touches only the agents in its own groups, so no agent locks are needed
+    std::vector<unsigned int> byPerson(batch.size());
+    std::iota(byPerson.begin(), byPerson.end(), 0);
+    std::sort(
+        byPerson.begin(), byPerson.end(),
+        [this](unsigned int a, unsigned int b) {
+            const Application& x = batch[a];
+            const Application& y = batch[b];
+            if (x.person->get_id() != y.person->get_id()) {
+                return x.person->get_id() < y.person->get_id();
+            }
+            return x.rank < y.rank;
+        }
+    );
+    auto personGroups = group_by(byPerson, [](const Application& a) { return a.person; });
+
+    std::vector<unsigned int> byFirm(batch.size());
+    std::iota(byFirm.begin(), byFirm.end(), 0);
+    std::sort(
+        byFirm.begin(), byFirm.end(),
+        [this](unsigned int a, unsigned int b) {
+            const Application& x = batch[a];
+            const Application& y = batch[b];
+            if (x.firm->get_id() != y.firm->get_id()) {
+                return x.firm->get_id() < y.firm->get_id();
+            }
+            if (x.offerKey != y.offerKey) {
+                return x.offerKey < y.offerKey;
+            }
+            if (x.offer.index != y.offer.index) {
+                return x.offer.index < y.offer.index;
+            }
+            if (x.person->get_id() != y.person->get_id()) {
+                return x.person->get_id() < y.person->get_id();
+            }
+            return x.rank < y.rank;
+        }
+    );
+    auto firmGroups = group_by(byFirm, [](const Application& a) { return a.firm; });
+
+    while (true) {
+        std::atomic<unsigned long> numProposed{0};
+        run(
+            personGroups.size(),
+            [&](unsigned int startIdx, unsigned int endIdx) {
+                unsigned long count = 0;
+                for (unsigned int i = startIdx; i < endIdx; i++) {
+                    count += propose(byPerson, personGroups[i].first, personGroups[i].second);
+                }
+                numProposed += count;
+            }
+        );
+        if (numProposed == 0) {
+            break;
+        }
+
+        std::atomic<unsigned long> numHired{0};
+        run(
+            firmGroups.size(),
+            [&](unsigned int startIdx, unsigned int endIdx) {
+                unsigned long count = 0;
+                for (unsigned int i = startIdx; i < endIdx; i++) {
+                    count += accept(byFirm, firmGroups[i].first, firmGroups[i].second);
+                }
+                numHired += count;
+            }
+        );
+        if (numHired > 0) {
+            run(
+                personGroups.size(),
+                [&](unsigned int startIdx, unsigned int endIdx) {
+                    for (unsigned int i = startIdx; i < endIdx; i++) {
+                        settle_person(byPerson, personGroups[i].first, personGroups[i].second);
+                    }
+                }
+            );
+        }
+    }
+    batch.clear();
+}
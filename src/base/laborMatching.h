@@ -0,0 +1,83 @@
+#ifndef LABOR_MATCHING_H
+#define LABOR_MATCHING_H
+
+#include <cstdint>
+#include <mutex>
+#include <utility>
+#include <vector>
+#include "slotMap.h"
+
+
+class Person;
+class Firm;
+class JobOffer;
+class ThreadPool;
+template <typename T> struct Order;
+
+
+class LaborMatching {
+    /**
+     * Collects persons' job applications during a decision phase & matches them to job offers all at once afterwards.
+     *
+     * Matching is deferred acceptance in rounds. In each round:
+     *  1. per person: the person applies for as many units of each job as its remaining labor allows,
+     *     going down its list in the order it chose them
+     *  2. per firm: each job offer takes as many applicants as it has units left & the firm can pay for;
+     *     if there are more applicants than places, places are rationed in proportion to the units applied for,
+     *     with leftover places going to the largest remainders (ties to the lower person id);
+     *     the firm pays the wages & hires the labor
+     *  3. per person: the person is paid & supplies the labor it was hired for
+     * Firms treat applicants as equals, so they never have a reason to drop an applicant they've taken;
+     * places are final once given. An application that isn't filled in full is closed (as a rejection would be),
+     * and the labor it held goes to the person's next choices in the following round.
+     * Rounds stop once nobody applies, so there are at most as many rounds as applications.
+     *
+     * Every pass is split into groups that touch disjoint agents, so each can run on the thread pool without locks,
+     * and the result depends only on the set of applications, not on the order they arrived in.
+     * As when a firm can't pay a wage outside batched mode, a job offer is withdrawn once its firm's budget runs out.
+     */
+public:
+    LaborMatching(SlotMap<JobOffer>& jobMarket);
+
+    // thread safe; applications are ranked in the order given
+    void add_applications(Person* person, const std::vector<Order<JobOffer>>& applications);
+
+    // matches as many of the collected applications as possible
+    // threadPool may be nullptr, in which case everything runs on the calling thread
+    void clear(ThreadPool* threadPool);
+
+    unsigned int get_numPending() const;
+
+private:
+    struct Application {
+        Person* person;
+        Firm* firm;
+        Handle<JobOffer> offer;
+        std::uint64_t offerKey;  // applications are sorted by key so the result doesn't depend on slot order
+        unsigned int rank;  // position in the person's list
+        unsigned int amount;  // units still wanted; 0 once filled or closed
+        unsigned int proposed = 0;  // units applied for this round
+        unsigned int filled = 0;  // units given this round
+    };
+
+    // splits batch, which must be sorted so that equal keys are adjacent, into [begin, end) runs of equal keys
+    template <typename Key>
+    std::vector<std::pair<unsigned int, unsigned int>> group_by(
+        const std::vector<unsigned int>& idx, Key key
+    ) const;
+
+    // each returns the number of units it applied for or gave
+    unsigned int propose(const std::vector<unsigned int>& idx, unsigned int begin, unsigned int end);
+    unsigned int accept(const std::vector<unsigned int>& idx, unsigned int begin, unsigned int end);
+    void settle_person(const std::vector<unsigned int>& idx, unsigned int begin, unsigned int end);
+
+    SlotMap<JobOffer>& jobMarket;
+
+    // applications collected since the last matching pass
+    std::vector<Application> applications;
+    // applications being matched; only touched inside clear, which must not run concurrently with itself
+    std::vector<Application> batch;
+    mutable std::mutex mutex;
+};
+
+#endif
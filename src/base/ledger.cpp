@@ -0,0 +1,201 @@
+#include <algorithm>
+#include <cstring>
+#include <numeric>
+#include <utility>
+#include "ledger.h"
+
+
+namespace {
+
+const char MAGIC[8] = {'f', 'a', 's', 't', 'A', 'C', 'E', 'x'};
+const std::uint32_t VERSION = 1;
+
+struct FileHeader {
+    char magic[8];
+    std::uint32_t version;
+    std::uint32_t numGoods;
+};
+
+struct ChunkHeader {
+    std::uint64_t numRows;
+    std::uint32_t time;
+    std::uint32_t padding = 0;
+};
+
+template <typename T>
+void write_column(std::ofstream& file, const std::vector<T>& column) {
+    file.write(reinterpret_cast<const char*>(column.data()), column.size() * sizeof(T));
+    static const char zeros[8] = {};
+    std::size_t remainder = (column.size() * sizeof(T)) % 8;
+    if (remainder != 0) {
+        file.write(zeros, 8 - remainder);
+    }
+}
+
+} // namespace
+
+
+Ledger::Ledger(const std::string& path, unsigned int numGoods) :
+    numGoods(numGoods),
+    file(path, std::ios::binary | std::ios::trunc)
+{
+    FileHeader header;
+    std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.version = VERSION;
+    header.numGoods = numGoods;
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    ok = file.good();
+    writer = std::thread(&Ledger::write_chunks, this);
+}
+
+Ledger::~Ledger() {
+    {
+        std::lock_guard<std::mutex> lock(queueMutex);
+        stopping = true;
+    }
+    queueChanged.notify_all();
+    writer.join();
+}
+
+
+void Ledger::record(
+    Kind kind,
+    std::uint32_t time,
+    std::uint32_t buyer,
+    std::uint32_t seller,
+    std::uint32_t units,
+    std::uint64_t key,
+    double price,
+    double labor,
+    const double* quantities
+) {
+    Buffer& buffer = buffers.local();
+    buffer.rows.push_back(Row{key, price, labor, time, buyer, seller, units, kind});
+    if (quantities != nullptr) {
+        buffer.quantities.insert(buffer.quantities.end(), quantities, quantities + numGoods);
+    }
+    else {
+        buffer.quantities.resize(buffer.quantities.size() + numGoods, 0.0);
+    }
+    numRows.fetch_add(1, std::memory_order_relaxed);
+}
+
+
+void Ledger::end_step(std::uint32_t time) {
+    Chunk chunk;
+    chunk.time = time;
+    // buffers keep their place (threads have cached them), so only their contents move
+    buffers.for_each([&](Buffer& buffer) {
+        if (!buffer.rows.empty()) {
+            chunk.buffers.emplace_back();
+            std::swap(chunk.buffers.back(), buffer);
+        }
+    });
+    if (chunk.buffers.empty()) {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(queueMutex);
+        queue.push_back(std::move(chunk));
+    }
+    queueChanged.notify_all();
+}
+
+void Ledger::flush() {
+    std::unique_lock<std::mutex> lock(queueMutex);
+    queueChanged.wait(lock, [this]() { return queue.empty() && !writing; });
+    file.flush();
+}
+
+bool Ledger::good() const { return ok; }
+
+std::uint64_t Ledger::get_numRows() const { return numRows.load(std::memory_order_relaxed); }
+
+
+void Ledger::write_chunks() {
+    std::unique_lock<std::mutex> lock(queueMutex);
+    while (true) {
+        queueChanged.wait(lock, [this]() { return !queue.empty() || stopping; });
+        if (queue.empty()) {
+            break;
+        }
+        Chunk chunk = std::move(queue.front());
+        queue.pop_front();
+        writing = true;
+        lock.unlock();
+        write_chunk(chunk);
+        lock.lock();
+        writing = false;
+        queueChanged.notify_all();
+    }
+    file.flush();
+    ok = ok && file.good();
+}
+
+void Ledger::write_chunk(Chunk& chunk) {
+    std::vector<std::pair<const Buffer*, unsigned int>> rows;
+    for (const auto& buffer : chunk.buffers) {
+        for (unsigned int i = 0; i < buffer.rows.size(); i++) {
+            rows.push_back(std::make_pair(&buffer, i));
+        }
+    }
+    // which thread recorded a fill depends on scheduling, so fills are put in an order that doesn't
+    auto get_row = [](const std::pair<const Buffer*, unsigned int>& row) -> const Row& {
+        return row.first->rows[row.second];
+    };
+    std::stable_sort(
+        rows.begin(), rows.end(),
+        [&](const std::pair<const Buffer*, unsigned int>& a, const std::pair<const Buffer*, unsigned int>& b) {
+            const Row& x = get_row(a);
+            const Row& y = get_row(b);
+            if (x.kind != y.kind) {
+                return x.kind < y.kind;
+            }
+            if (x.key != y.key) {
+                return x.key < y.key;
+            }
+            if (x.buyer != y.buyer) {
+                return x.buyer < y.buyer;
+            }
+            return x.units < y.units;
+        }
+    );
+
+    std::size_t n = rows.size();
+    std::vector<std::uint64_t> keys(n);
+    std::vector<double> prices(n), labors(n), quantities(n * numGoods);
+    std::vector<std::uint32_t> times(n), buyers(n), sellers(n), units(n);
+    std::vector<std::uint8_t> kinds(n);
+    for (std::size_t i = 0; i < n; i++) {
+        const Row& row = get_row(rows[i]);
+        keys[i] = row.key;
+        prices[i] = row.price;
+        labors[i] = row.labor;
+        times[i] = row.time;
+        buyers[i] = row.buyer;
+        sellers[i] = row.seller;
+        units[i] = row.units;
+        kinds[i] = static_cast<std::uint8_t>(row.kind);
+        const double* q = rows[i].first->quantities.data() + std::size_t(rows[i].second) * numGoods;
+        for (unsigned int g = 0; g < numGoods; g++) {
+            quantities[g * n + i] = q[g];
+        }
+    }
+
+    ChunkHeader header;
+    header.numRows = n;
+    header.time = chunk.time;
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    write_column(file, keys);
+    write_column(file, prices);
+    write_column(file, labors);
+    write_column(file, quantities);
+    write_column(file, times);
+    write_column(file, buyers);
+    write_column(file, sellers);
+    write_column(file, units);
+    write_column(file, kinds);
+    if (!file.good()) {
+        ok = false;
+    }
+}
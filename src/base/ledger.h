@@ -0,0 +1,111 @@
+#ifndef LEDGER_H
+#define LEDGER_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "perThread.h"
+
+
+class Ledger {
+    /**
+     * An append-only record of every trade in an economy: each fill of a goods offer & each labor match.
+     *
+     * Each thread appends to its own buffer, without locking. At the end of each time step the economy hands
+     * the step's buffers to a writer thread, which sorts the fills (so a reproducible run writes the same file)
+     * & appends them to the ledger's file as one columnar chunk. The simulation never waits for the file.
+     *
+     * File layout (little-endian): a 16-byte header {char magic[8] = "fastACEx", u32 version, u32 numGoods},
+     * then one chunk per step that had any trades. Each chunk is a 16-byte header {u64 numRows, u32 time, u32 0}
+     * followed by its columns, in this order, each numRows long & padded to a multiple of 8 bytes:
+     *  u64 key, f64 price, f64 labor, numGoods f64 quantity columns (one per good),
+     *  u32 time, u32 buyer, u32 seller, u32 units, u8 kind
+     * so every column can be mapped in place (see py/ledger.py).
+     * price, labor & quantities are per unit; kind is 0 for goods & 1 for labor, where the buyer is the firm.
+     */
+public:
+    enum class Kind : std::uint8_t {
+        Goods,
+        Labor
+    };
+
+    // opens (truncating) the file at path & starts the writer thread
+    Ledger(const std::string& path, unsigned int numGoods);
+    // writes everything recorded so far before returning
+    ~Ledger();
+
+    Ledger(const Ledger&) = delete;
+    Ledger& operator=(const Ledger&) = delete;
+
+    // thread safe & lock-free, except the first time each thread records
+    // quantities has numGoods entries, or is nullptr for labor
+    void record(
+        Kind kind,
+        std::uint32_t time,
+        std::uint32_t buyer,
+        std::uint32_t seller,
+        std::uint32_t units,
+        std::uint64_t key,
+        double price,
+        double labor,
+        const double* quantities
+    );
+
+    // hands everything recorded since the last call to the writer thread
+    // must only be called while no thread is recording, e.g. at the end of a time step
+    void end_step(std::uint32_t time);
+    // blocks until the writer thread has written everything handed to it
+    void flush();
+
+    // false if the file couldn't be opened or written
+    bool good() const;
+    // fills recorded over the ledger's lifetime
+    std::uint64_t get_numRows() const;
+
+private:
+    struct Row {
+        std::uint64_t key;
+        double price;
+        double labor;
+        std::uint32_t time;
+        std::uint32_t buyer;
+        std::uint32_t seller;
+        std::uint32_t units;
+        Kind kind;
+    };
+    struct Buffer {
+        std::vector<Row> rows;
+        std::vector<double> quantities;  // numGoods per row
+    };
+    struct Chunk {
+        std::uint32_t time;
+        std::vector<Buffer> buffers;
+    };
+
+    void write_chunks();
+    void write_chunk(Chunk& chunk);
+
+    const unsigned int numGoods;
+    std::atomic<std::uint64_t> numRows{0};
+
+    // only swapped out in end_step, when nobody is recording
+    PerThread<Buffer> buffers;
+
+    std::mutex queueMutex;
+    std::condition_variable queueChanged;
+    std::deque<Chunk> queue;
+    bool writing = false;
+    bool stopping = false;
+    std::atomic<bool> ok{true};
+    std::ofstream file;
+    std::thread writer;
+};
+
+#endif
@@ -0,0 +1,79 @@
+#ifndef MARKET_SNAPSHOT_H
+#define MARKET_SNAPSHOT_H
+
+#include <algorithm>
+#include <vector>
+#include "slotMap.h"
+
+
+template <typename T>
+class MarketSnapshot {
+    /**
+     * The offers that were available in a market (a SlotMap<T>) at the start of the time step.
+     *
+     * The Economy takes the snapshot at the step barrier, in one pass over the market; during the step
+     * readers all share it without locking or copying, however many offers are posted in the meantime.
+     * Handles are sorted by region, then by offer key, so their order doesn't depend on which slots offers landed in.
+     * Offers can still sell out during the step, so readers should check is_available() before relying on one.
+     *
+     * It's double buffered: update builds the new snapshot in the buffer that wasn't handed out this step,
+     * reusing its memory, and then swaps. So what readers were handed stays valid until the update after next.
+     */
+public:
+    // takes a new snapshot of market, as of the start of time step time
+    // must only be called while nothing is reading the snapshot or writing to the market (e.g. in Economy::begin_step)
+    void update(const SlotMap<T>& market, unsigned int time) {
+        Buffer& next = buffers[1 - front];
+        next.time = time;
+        next.offers.clear();
+        next.regionStart.assign(1, 0);
+        auto byKey = [&market](Handle<T> a, Handle<T> b) { return market.get(a)->key < market.get(b)->key; };
+        for (unsigned int region = 0; region < market.get_numShards(); region++) {
+            market.for_each_in(
+                region,
+                [&next](Handle<T> handle, const T& offer) {
+                    // sold out offers stay on the market as tombstones until it's compacted
+                    if (offer.is_available()) {
+                        next.offers.push_back(handle);
+                    }
+                }
+            );
+            std::sort(next.offers.begin() + next.regionStart.back(), next.offers.end(), byKey);
+            next.regionStart.push_back(next.offers.size());
+        }
+        front = 1 - front;
+    }
+
+    // every region's offers, region by region
+    const std::vector<Handle<T>>& get_offers() const { return buffers[front].offers; }
+    // the offers in one region are [begin(region), end(region)); empty for regions the market didn't have
+    const Handle<T>* begin(unsigned int region) const {
+        const Buffer& buffer = buffers[front];
+        if (region + 1 >= buffer.regionStart.size()) {
+            return buffer.offers.data() + buffer.offers.size();
+        }
+        return buffer.offers.data() + buffer.regionStart[region];
+    }
+    const Handle<T>* end(unsigned int region) const {
+        const Buffer& buffer = buffers[front];
+        if (region + 1 >= buffer.regionStart.size()) {
+            return buffer.offers.data() + buffer.offers.size();
+        }
+        return buffer.offers.data() + buffer.regionStart[region + 1];
+    }
+    // the time step the snapshot was taken at, or 0 if it hasn't been taken yet
+    unsigned int get_time() const { return buffers[front].time; }
+
+private:
+    struct Buffer {
+        unsigned int time = 0;
+        std::vector<Handle<T>> offers;
+        // where each region's offers start, plus one past the end
+        std::vector<unsigned int> regionStart;
+    };
+
+    Buffer buffers[2];
+    unsigned int front = 0;
+};
+
+#endif
@@ -0,0 +1,102 @@
+#include <limits>
+#include "marketStats.h"
+
+
+MarketStats::MarketStats(unsigned int numGoods) :
+    numGoods(numGoods),
+    accumulators([numGoods]() {
+        std::unique_ptr<Accumulator> accumulator(new Accumulator());
+        accumulator->spent = Eigen::ArrayXd::Zero(numGoods);
+        accumulator->volume = Eigen::ArrayXd::Zero(numGoods);
+        accumulator->depthChange = Eigen::ArrayXd::Zero(numGoods);
+        return accumulator;
+    }),
+    depth(Eigen::ArrayXd::Zero(numGoods)) {}
+
+
+void MarketStats::record_post(const Eigen::Ref<const Eigen::ArrayXd>& quantities, unsigned int units) {
+    if (units == 0) {
+        return;
+    }
+    accumulators.local().depthChange += quantities * units;
+}
+
+void MarketStats::record_fill(const Eigen::Ref<const Eigen::ArrayXd>& quantities, double price, unsigned int units) {
+    if (units == 0) {
+        return;
+    }
+    Accumulator& accumulator = accumulators.local();
+    accumulator.spent += (quantities > 0).cast<double>() * (price * units);
+    accumulator.volume += quantities * units;
+    accumulator.depthChange -= quantities * units;
+    accumulator.numFills++;
+}
+
+void MarketStats::record_withdrawal(const Eigen::Ref<const Eigen::ArrayXd>& quantities, unsigned int units) {
+    if (units == 0) {
+        return;
+    }
+    accumulators.local().depthChange -= quantities * units;
+}
+
+void MarketStats::record_hire(double wage, double labor, unsigned int units) {
+    if (units == 0) {
+        return;
+    }
+    Accumulator& accumulator = accumulators.local();
+    accumulator.wageBill += wage * units;
+    accumulator.laborHired += labor * units;
+    accumulator.numHires++;
+}
+
+
+const MarketStats::Step& MarketStats::end_step(unsigned int time, const Eigen::ArrayXd& bestAsk) {
+    Eigen::ArrayXd spent = Eigen::ArrayXd::Zero(numGoods);
+    Step step;
+    step.time = time;
+    step.volume = Eigen::ArrayXd::Zero(numGoods);
+    step.laborHired = 0.0;
+    step.numFills = 0;
+    step.numHires = 0;
+    double wageBill = 0.0;
+    accumulators.for_each([&](Accumulator& accumulator) {
+        spent += accumulator.spent;
+        step.volume += accumulator.volume;
+        depth += accumulator.depthChange;
+        wageBill += accumulator.wageBill;
+        step.laborHired += accumulator.laborHired;
+        step.numFills += accumulator.numFills;
+        step.numHires += accumulator.numHires;
+        accumulator.spent.setZero();
+        accumulator.volume.setZero();
+        accumulator.depthChange.setZero();
+        accumulator.wageBill = 0.0;
+        accumulator.laborHired = 0.0;
+        accumulator.numFills = 0;
+        accumulator.numHires = 0;
+    });
+    const double nan = std::numeric_limits<double>::quiet_NaN();
+    step.vwap = (step.volume > 0).select(spent / step.volume, nan);
+    step.wageIndex = (step.laborHired > 0) ? wageBill / step.laborHired : nan;
+    // units are added & taken away in different orders, so clamp the rounding error around an empty market
+    depth = depth.max(0.0);
+    step.depth = depth;
+    step.bestAsk = bestAsk;
+    history.push_back(step);
+    return history.back();
+}
+
+void MarketStats::reset_depth(const Eigen::ArrayXd& depth) {
+    // changes recorded so far were to the market being replaced
+    accumulators.for_each([](Accumulator& accumulator) { accumulator.depthChange.setZero(); });
+    this->depth = depth;
+}
+
+
+const std::vector<MarketStats::Step>& MarketStats::get_history() const { return history; }
+
+const MarketStats::Step* MarketStats::get_latest() const {
+    return history.empty() ? nullptr : &history.back();
+}
+
+unsigned int MarketStats::get_numGoods() const { return numGoods; }
@@ -0,0 +1,85 @@
+#ifndef MARKET_STATS_H
+#define MARKET_STATS_H
+
+#include <vector>
+#include <Eigen/Dense>
+#include "perThread.h"
+
+
+class MarketStats {
+    /**
+     * Per-step aggregates of an economy's markets, kept up to date as offers are posted, filled & withdrawn
+     * rather than by scanning the markets.
+     *
+     * Each thread accumulates into its own buffer, without locking; end_step adds the buffers up
+     * into one row of the time series. Depth is carried over from step to step and moved by deltas:
+     * up when units are posted, down when they're sold or withdrawn.
+     *
+     * As in the OrderBook, the unit price of a good in an offer is price / quantity of that good,
+     * so an offer of a bundle counts in full toward each good it contains.
+     * Sums are added up in whatever order threads happened to create their buffers,
+     * so with several threads the statistics can differ in the last bits from run to run.
+     */
+public:
+    // one row of the time series
+    struct Step {
+        unsigned int time;
+        // money spent per unit of each good bought this step; NaN for goods that weren't traded
+        Eigen::ArrayXd vwap;
+        // lowest unit price on offer at the end of the step; negative for goods with no offers
+        Eigen::ArrayXd bestAsk;
+        // units of each good on offer at the end of the step
+        Eigen::ArrayXd depth;
+        // units of each good bought this step
+        Eigen::ArrayXd volume;
+        // wages paid per unit of labor hired this step; NaN if nobody was hired
+        double wageIndex;
+        double laborHired;
+        unsigned long numFills;
+        unsigned long numHires;
+    };
+
+    MarketStats(unsigned int numGoods);
+
+    MarketStats(const MarketStats&) = delete;
+    MarketStats& operator=(const MarketStats&) = delete;
+
+    // all thread safe & lock-free, except the first time each thread records
+    void record_post(const Eigen::Ref<const Eigen::ArrayXd>& quantities, unsigned int units);
+    void record_fill(const Eigen::Ref<const Eigen::ArrayXd>& quantities, double price, unsigned int units);
+    void record_withdrawal(const Eigen::Ref<const Eigen::ArrayXd>& quantities, unsigned int units);
+    void record_hire(double wage, double labor, unsigned int units);
+
+    // adds up everything recorded since the last call into a new row of the time series & returns it
+    // must only be called while no thread is recording, e.g. at the end of a time step
+    const Step& end_step(unsigned int time, const Eigen::ArrayXd& bestAsk);
+    // replaces the running depth & drops the depth changes recorded since the last step,
+    // after the market was changed without going through the economy (e.g. restored)
+    void reset_depth(const Eigen::ArrayXd& depth);
+
+    // one row per step since the statistics were enabled, oldest first
+    const std::vector<Step>& get_history() const;
+    // the most recent row, or nullptr if no step has ended yet
+    const Step* get_latest() const;
+    unsigned int get_numGoods() const;
+
+private:
+    struct Accumulator {
+        Eigen::ArrayXd spent;
+        Eigen::ArrayXd volume;
+        Eigen::ArrayXd depthChange;
+        double wageBill = 0.0;
+        double laborHired = 0.0;
+        unsigned long numFills = 0;
+        unsigned long numHires = 0;
+    };
+
+    const unsigned int numGoods;
+    // only reset in end_step, when nobody is recording
+    PerThread<Accumulator> accumulators;
+
+    Eigen::ArrayXd depth;
+    std::vector<Step> history;
+};
+
+#endif
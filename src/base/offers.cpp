@@ -1,27 +1,135 @@
 #include "base.h"
 
 
+BaseOffer::BaseOffer() : offerer(nullptr), amountLeft(0) {}
+
 BaseOffer::BaseOffer(
-    std::weak_ptr<Agent> offerer,
+    Agent* offerer,
     unsigned int amount_available
-) : offerer(offerer), amountLeft(amount_available) {}
+) : amountLeft(amount_available), offerer(offerer) {}
+
+BaseOffer::BaseOffer(const BaseOffer& other)
+    : amountLeft(other.amountLeft.load()),
+    amountTaken(other.amountTaken.load()),
+    amountUnsettled(other.amountUnsettled.load()),
+    offerer(other.offerer),
+    key(other.key) {}
+
+BaseOffer& BaseOffer::operator=(const BaseOffer& other) {
+    amountLeft = other.amountLeft.load();
+    amountTaken = other.amountTaken.load();
+    amountUnsettled = other.amountUnsettled.load();
+    offerer = other.offerer;
+    key = other.key;
+    return *this;
+}
 
 bool BaseOffer::is_available() const {
     return (amountLeft > 0);
 }
 
+unsigned int BaseOffer::reserve(unsigned int amount, bool& soldOut) {
+    soldOut = false;
+    unsigned int left = amountLeft.load(std::memory_order_relaxed);
+    amount = std::min(left, amount);
+    if (amount == 0) {
+        return 0;
+    }
+    // the units count toward amountReserving from before they leave amountLeft until they're in amountUnsettled,
+    // so an offerer adding up what it owes (see get_amountCommitted) can't miss them in between
+    amountReserving += amount;
+    unsigned int taken = 0;
+    while (left > 0) {
+        taken = std::min(left, amount);
+        if (amountLeft.compare_exchange_weak(left, left - taken)) {
+            soldOut = (taken == left);
+            amountUnsettled += taken;
+            amountTaken += taken;
+            break;
+        }
+        taken = 0;
+    }
+    amountReserving -= amount;
+    return taken;
+}
+
+unsigned int BaseOffer::get_amountCommitted() const {
+    // a reservation moves units out of amountLeft & into amountUnsettled while it's counted in amountReserving,
+    // so reading the three in this order sees every unit at least once
+    unsigned int left = amountLeft.load();
+    unsigned int reserving = amountReserving.load();
+    unsigned int unsettled = amountUnsettled.load();
+    return left + reserving + unsettled;
+}
+
+unsigned int BaseOffer::get_amountPending() const {
+    // units reach amountUnsettled before they leave amountReserving, so read amountReserving first
+    unsigned int reserving = amountReserving.load();
+    unsigned int unsettled = amountUnsettled.load();
+    return reserving + unsettled;
+}
+
+void BaseOffer::reset(Agent* offerer, unsigned int amount_available, std::uint64_t key) {
+    amountLeft.store(amount_available, std::memory_order_relaxed);
+    amountTaken.store(0, std::memory_order_relaxed);
+    amountUnsettled.store(0, std::memory_order_relaxed);
+    amountReserving.store(0, std::memory_order_relaxed);
+    this->offerer = offerer;
+    this->key = key;
+}
+
+unsigned int BaseOffer::limit_amountLeft(unsigned int maxAmount, unsigned int& removed) {
+    unsigned int left = amountLeft.load(std::memory_order_relaxed);
+    while (left > maxAmount) {
+        if (amountLeft.compare_exchange_weak(left, maxAmount, std::memory_order_acq_rel)) {
+            removed = left - maxAmount;
+            return maxAmount;
+        }
+    }
+    removed = 0;
+    return left;
+}
+
+
+Offer::Offer() : BaseOffer(), price(0.0) {}
 
 Offer::Offer(
-    std::weak_ptr<Agent> offerer,
+    Agent* offerer,
     unsigned int amount_available,
-    Eigen::ArrayXd quantities,
+    const Eigen::Ref<const Eigen::ArrayXd>& quantities,
     double price
 ) : BaseOffer(offerer, amount_available), quantities(quantities), price(price) {}
 
+void Offer::assign(
+    Agent* offerer,
+    unsigned int amount_available,
+    const Eigen::Ref<const Eigen::ArrayXd>& quantities,
+    double price,
+    std::uint64_t key
+) {
+    reset(offerer, amount_available, key);
+    this->quantities = quantities;
+    this->price = price;
+}
+
+
+JobOffer::JobOffer() : BaseOffer(), labor(0.0), wage(0.0) {}
 
 JobOffer::JobOffer(
-    std::weak_ptr<Firm> offerer,
+    Firm* offerer,
     unsigned int amount_available,
     double labor,
     double wage
 ) : BaseOffer(offerer, amount_available), labor(labor), wage(wage) {}
+
+void JobOffer::assign(
+    Firm* offerer,
+    unsigned int amount_available,
+    double labor,
+    double wage,
+    std::uint64_t key
+) {
+    reset(offerer, amount_available, key);
+    this->labor = labor;
+    this->wage = wage;
+}
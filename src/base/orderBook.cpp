@@ -0,0 +1,112 @@
+#include "orderBook.h"
+#include "base.h"
+
+
+OrderBook::OrderBook(
+    const SlotMap<Offer>& market,
+    unsigned int numGoods
+) : market(market), numGoods(numGoods), books(numGoods) {}
+
+
+void OrderBook::add_offer(Handle<Offer> handle) {
+    pending.local().push_back(handle);
+}
+
+void OrderBook::list_pending() {
+    std::lock_guard<std::mutex> lock(mutex);
+    pending.for_each([this](std::vector<Handle<Offer>>& handles) {
+        for (auto handle : handles) {
+            // offers that sold out in the meantime are still listed, & dropped by queries like any other
+            const Offer* offer = market.get(handle);
+            if (offer == nullptr) {
+                continue;
+            }
+            for (unsigned int i = 0; i < numGoods; i++) {
+                if (offer->quantities(i) > 0) {
+                    books[i].insert(Listing{offer->price / offer->quantities(i), offer->key, handle});
+                }
+            }
+        }
+        handles.clear();
+    });
+}
+
+void OrderBook::remove_offer(Handle<Offer> handle) {
+    const Offer* offer = market.get(handle);
+    if (offer == nullptr) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(mutex);
+    for (unsigned int i = 0; i < numGoods; i++) {
+        if (offer->quantities(i) > 0) {
+            books[i].erase(Listing{offer->price / offer->quantities(i), offer->key, handle});
+        }
+    }
+}
+
+void OrderBook::flush() {
+    std::lock_guard<std::mutex> lock(mutex);
+    for (auto& book : books) {
+        for (auto it = book.begin(); it != book.end();) {
+            if (!is_live(*it)) {
+                it = book.erase(it);
+            }
+            else {
+                ++it;
+            }
+        }
+    }
+}
+
+
+bool OrderBook::is_live(const Listing& listing) const {
+    const Offer* offer = market.get(listing.offer);
+    return offer != nullptr && offer->is_available();
+}
+
+void OrderBook::pop_unavailable(unsigned int good) {
+    auto& book = books[good];
+    while (!book.empty()) {
+        if (is_live(*book.begin())) {
+            return;
+        }
+        book.erase(book.begin());
+    }
+}
+
+Handle<Offer> OrderBook::best_offer(unsigned int good) {
+    std::lock_guard<std::mutex> lock(mutex);
+    pop_unavailable(good);
+    if (books[good].empty()) {
+        return {};
+    }
+    return books[good].begin()->offer;
+}
+
+double OrderBook::best_price(unsigned int good) {
+    std::lock_guard<std::mutex> lock(mutex);
+    pop_unavailable(good);
+    if (books[good].empty()) {
+        return -1.0;
+    }
+    return books[good].begin()->unitPrice;
+}
+
+std::vector<Handle<Offer>> OrderBook::top_offers(unsigned int good, unsigned int k) {
+    std::lock_guard<std::mutex> lock(mutex);
+    pop_unavailable(good);
+    std::vector<Handle<Offer>> top;
+    top.reserve(std::min<size_t>(k, books[good].size()));
+    for (auto it = books[good].begin(); it != books[good].end() && top.size() < k; ++it) {
+        // listings past the front may be stale; skip them here and leave them for flush
+        if (is_live(*it)) {
+            top.push_back(it->offer);
+        }
+    }
+    return top;
+}
+
+unsigned int OrderBook::depth(unsigned int good) const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return books[good].size();
+}
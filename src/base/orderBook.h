@@ -0,0 +1,86 @@
+#ifndef ORDER_BOOK_H
+#define ORDER_BOOK_H
+
+#include <cstdint>
+#include <mutex>
+#include <set>
+#include <vector>
+#include "perThread.h"
+#include "slotMap.h"
+
+
+class Offer;
+
+
+class OrderBook {
+    /**
+     * Indexes the offers in an Economy's goods market by good, sorted by unit price.
+     *
+     * An offer is listed under every good it contains, at a unit price of price / quantity of that good.
+     * The Economy adds offers as they are posted and flushes the book along with the market;
+     * offerers remove offers as they sell out. Offers that become unavailable some other way
+     * are skipped (and dropped) lazily by queries.
+     * Listings refer to offers by handle into the Economy's market, so a stale listing is detected in O(1).
+     *
+     * Adding an offer takes no lock: each thread keeps the offers it added in its own buffer,
+     * and list_pending moves them all into the book at once (in the economy, at each phase barrier).
+     * Until then the offer is on the market but not in the book.
+     *
+     * Best-price lookup is O(log n) amortized and top-k queries are O(k log n).
+     */
+public:
+    OrderBook(const SlotMap<Offer>& market, unsigned int numGoods);
+
+    // thread safe & lock-free, except the first time each thread adds; the offer is listed by the next list_pending
+    void add_offer(Handle<Offer> offer);
+    // lists the offers added since the last call; must only be called while nobody is adding
+    // listings don't depend on the order offers were added in, so neither does the book
+    void list_pending();
+    // removes all of offer's listings; offer must still be on the market
+    void remove_offer(Handle<Offer> offer);
+    // drops listings for offers that are expired or no longer available
+    void flush();
+
+    // cheapest available offer for the given good; returns a default (invalid) handle if there isn't one
+    Handle<Offer> best_offer(unsigned int good);
+    // unit price of best_offer(good), or a negative number if there are no offers
+    double best_price(unsigned int good);
+    // up to k available offers for the given good, cheapest first
+    std::vector<Handle<Offer>> top_offers(unsigned int good, unsigned int k);
+    // number of listings for the given good, including any not yet lazily dropped
+    unsigned int depth(unsigned int good) const;
+
+private:
+    struct Listing {
+        double unitPrice;
+        std::uint64_t key;  // the offer's key
+        Handle<Offer> offer;
+
+        bool operator<(const Listing& other) const {
+            if (unitPrice != other.unitPrice) {
+                return unitPrice < other.unitPrice;
+            }
+            // break ties by offer key, so ordering doesn't depend on which slots offers landed in
+            if (key != other.key) {
+                return key < other.key;
+            }
+            if (offer.index != other.offer.index) {
+                return offer.index < other.offer.index;
+            }
+            return offer.generation < other.offer.generation;
+        }
+    };
+
+    // whether the listed offer is still on the market & available
+    bool is_live(const Listing& listing) const;
+    // drops unavailable listings from the front of the book for good; must hold mutex
+    void pop_unavailable(unsigned int good);
+
+    const SlotMap<Offer>& market;
+    unsigned int numGoods;
+    std::vector<std::set<Listing>> books;  // one per good
+    mutable std::mutex mutex;
+    PerThread<std::vector<Handle<Offer>>> pending;
+};
+
+#endif
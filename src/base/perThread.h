@@ -0,0 +1,121 @@
+#ifndef PER_THREAD_H
+#define PER_THREAD_H
+
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+
+namespace perThread {
+
+// an entry in a thread's cache of its values, at the index of the PerThread that owns the value
+struct CachedValue {
+    std::uint64_t ownerId = std::numeric_limits<std::uint64_t>::max();
+    void* value = nullptr;
+};
+
+inline std::vector<CachedValue>& local_cache() {
+    thread_local std::vector<CachedValue> cache;
+    return cache;
+}
+
+// hands out ids, which are never reused, & cache indices, which are reused once their PerThread is gone
+// so that threads' caches stay as short as the number of PerThreads alive at once
+class Registry {
+public:
+    static Registry& get() {
+        static Registry registry;
+        return registry;
+    }
+
+    void acquire(std::uint64_t& id, unsigned int& index) {
+        std::lock_guard<std::mutex> lock(mutex);
+        id = nextId++;
+        if (freeIndices.empty()) {
+            index = numIndices++;
+        }
+        else {
+            index = freeIndices.back();
+            freeIndices.pop_back();
+        }
+    }
+
+    void release(unsigned int index) {
+        std::lock_guard<std::mutex> lock(mutex);
+        freeIndices.push_back(index);
+    }
+
+private:
+    std::mutex mutex;
+    std::uint64_t nextId = 0;
+    unsigned int numIndices = 0;
+    std::vector<unsigned int> freeIndices;
+};
+
+} // namespace perThread
+
+
+template <typename T>
+class PerThread {
+    /**
+     * One T for each thread that asks for one, so that threads can record into their own T without locking.
+     *
+     * A thread finds its T in O(1), at this PerThread's index in a thread_local cache; only the first call
+     * on each thread takes a lock. Indices are reused once a PerThread is destroyed, but ids aren't,
+     * so a cache entry left behind by a destroyed PerThread is recognized as stale & overwritten.
+     * The values are owned here & never move, so once nobody is writing to them (e.g. between phases of a step)
+     * they can all be visited, e.g. to add them up or drain them.
+     */
+public:
+    // make builds each new value, on the thread that first asks for it
+    explicit PerThread(std::function<std::unique_ptr<T>()> make = []() { return std::unique_ptr<T>(new T()); })
+        : make(make) {
+        perThread::Registry::get().acquire(id, index);
+    }
+
+    ~PerThread() { perThread::Registry::get().release(index); }
+
+    PerThread(const PerThread&) = delete;
+    PerThread& operator=(const PerThread&) = delete;
+
+    // the calling thread's value
+    T& local() {
+        auto& cache = perThread::local_cache();
+        if (index < cache.size() && cache[index].ownerId == id) {
+            return *static_cast<T*>(cache[index].value);
+        }
+        std::unique_ptr<T> value = make();
+        T* ptr = value.get();
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            values.push_back(std::move(value));
+        }
+        if (cache.size() <= index) {
+            cache.resize(index + 1);
+        }
+        cache[index] = perThread::CachedValue{id, ptr};
+        return *ptr;
+    }
+
+    // calls f(value) for each thread's value, in the order they were created
+    // must only be called while no thread is writing to its value
+    template <typename F>
+    void for_each(F f) {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (auto& value : values) {
+            f(*value);
+        }
+    }
+
+private:
+    std::uint64_t id;  // never reused, so a cache entry can't be mistaken for another PerThread's
+    unsigned int index;  // where threads cache their value
+    std::function<std::unique_ptr<T>()> make;
+    std::mutex mutex;
+    std::vector<std::unique_ptr<T>> values;
+};
+
+#endif
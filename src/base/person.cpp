@@ -1,10 +1,10 @@
 #include "base.h"
 
-Person::Person(Economy* economy) : Agent(economy) {}
+Person::Person(Economy* economy) : Agent(economy), laborSupplied(labor) {}
 
 Person::Person(
     Economy* economy, Eigen::ArrayXd inventory, double money
-) : Agent(economy, inventory, money) {}
+) : Agent(economy, inventory, money), laborSupplied(labor) {}
 
 std::string Person::get_typename() const {
     return "Person";
@@ -22,33 +22,49 @@ bool Person::time_step() {
     }
     else {
         laborSupplied = 0.0;
-        util::print_status(this, "Searching for job...");
+        trace::record(3, trace::Event::SearchForJobs, id, time);
         search_for_jobs();
-        util::print_status(this, "Buying goods...");
+        trace::record(3, trace::Event::BuyGoods, id, time);
         buy_goods();
-        util::print_status(this, "Consuming goods...");
+        trace::record(3, trace::Event::ConsumeGoods, id, time);
         consume_goods();
         return true;
     }
 }
 
 
-bool Person::respond_to_jobOffer(std::weak_ptr<const JobOffer> jobOffer_) {
+bool Person::respond_to_jobOffer(JobOfferHandle handle) {
     // check that the person actually has enough labor remaining, then send to offerer
-    auto jobOffer = jobOffer_.lock();
-    if (jobOffer != nullptr && laborSupplied + jobOffer->labor <= 1) {
-        util::print_status(this, "Asking for jobOffer acceptance...");
-        bool accepted = std::static_pointer_cast<Firm>(
-            jobOffer->offerer.lock()
-        )->review_jobOffer_response(
-            std::static_pointer_cast<Person>(shared_from_this()), jobOffer
+    const JobOffer* jobOffer = economy->get_jobOffer(handle);
+    if (
+        jobOffer != nullptr && laborSupplied + jobOffer->labor <= 1
+        && economy->can_trade(jobOffer->offerer, this)
+    ) {
+        trace::record(3, trace::Event::RespondToJobOffer, id, time, handle.index, jobOffer->wage);
+        bool accepted = static_cast<Firm*>(jobOffer->offerer)->review_jobOffer_response(
+            std::static_pointer_cast<Person>(shared_from_this()), handle
         );
         if (accepted) {
             std::lock_guard<std::mutex> lock(myMutex);
             laborSupplied += jobOffer->labor;
             money += jobOffer->wage;
+            economy->record_hire(this, *jobOffer, 1);
             return true;
         }
     }
     return false;
 }
+
+void Person::apply_for_jobs(const std::vector<Order<JobOffer>>& applications) {
+    if (economy->get_batchedClearing()) {
+        economy->laborMatching.add_applications(this, applications);
+        return;
+    }
+    for (auto application : applications) {
+        for (unsigned int i = 0; i < application.amount; i++) {
+            if (!respond_to_jobOffer(application.offer)) {
+                break;
+            }
+        }
+    }
+}
@@ -0,0 +1,66 @@
+#include "philox.h"
+
+namespace util {
+
+namespace {
+
+const std::uint32_t PHILOX_M0 = 0xD2511F53;
+const std::uint32_t PHILOX_M1 = 0xCD9E8D57;
+const std::uint32_t PHILOX_W0 = 0x9E3779B9;
+const std::uint32_t PHILOX_W1 = 0xBB67AE85;
+const unsigned int PHILOX_ROUNDS = 10;
+
+inline void mulhilo(std::uint32_t a, std::uint32_t b, std::uint32_t& hi, std::uint32_t& lo) {
+    std::uint64_t product = static_cast<std::uint64_t>(a) * b;
+    hi = static_cast<std::uint32_t>(product >> 32);
+    lo = static_cast<std::uint32_t>(product);
+}
+
+} // namespace
+
+
+Philox::Philox() : Philox(0, 0, 0) {}
+
+Philox::Philox(
+    std::uint64_t seed,
+    std::uint64_t stream,
+    std::uint32_t substream
+) : key{{static_cast<std::uint32_t>(seed), static_cast<std::uint32_t>(seed >> 32)}},
+    counter{{0, substream, static_cast<std::uint32_t>(stream), static_cast<std::uint32_t>(stream >> 32)}} {}
+
+
+void Philox::generate_block() {
+    std::array<std::uint32_t, 4> x = counter;
+    std::array<std::uint32_t, 2> k = key;
+    for (unsigned int round = 0; round < PHILOX_ROUNDS; round++) {
+        std::uint32_t hi0, lo0, hi1, lo1;
+        mulhilo(PHILOX_M0, x[0], hi0, lo0);
+        mulhilo(PHILOX_M1, x[2], hi1, lo1);
+        x = {{hi1 ^ x[1] ^ k[0], lo1, hi0 ^ x[3] ^ k[1], lo0}};
+        k[0] += PHILOX_W0;
+        k[1] += PHILOX_W1;
+    }
+    block = x;
+    blockIdx = 0;
+    counter[0]++;
+}
+
+
+Philox::result_type Philox::operator()() {
+    if (blockIdx == 4) {
+        generate_block();
+    }
+    return block[blockIdx++];
+}
+
+
+double Philox::uniform() {
+    // 53 random bits, as in std::generate_canonical
+    // drawn one statement at a time, since the order two calls in one expression run in is up to the compiler
+    std::uint64_t hi = (*this)();
+    std::uint64_t lo = (*this)();
+    std::uint64_t bits = (hi << 21) ^ (lo >> 11);
+    return bits * (1.0 / 9007199254740992.0);
+}
+
+} // namespace util
@@ -0,0 +1,45 @@
+#ifndef PHILOX_H
+#define PHILOX_H
+
+#include <array>
+#include <cstdint>
+
+namespace util {
+
+class Philox {
+    /**
+     * Philox4x32-10 counter-based random number generator (Salmon et al., 2011).
+     *
+     * Each output block is a pure function of (seed, stream, substream, block index),
+     * so generators for different agents and time steps are independent,
+     * need no shared state, and can be created in O(1) without warm-up.
+     * Satisfies the standard UniformRandomBitGenerator requirements,
+     * so it can be used with std::shuffle and the <random> distributions.
+     */
+public:
+    using result_type = std::uint32_t;
+
+    Philox();
+    Philox(std::uint64_t seed, std::uint64_t stream, std::uint32_t substream);
+
+    result_type operator()();
+
+    static constexpr result_type min() { return 0; }
+    static constexpr result_type max() { return UINT32_MAX; }
+
+    // uniform double in [0, 1)
+    double uniform();
+
+private:
+    void generate_block();
+
+    std::array<std::uint32_t, 2> key;
+    // counter[0] counts blocks within a stream, counter[1] is the substream, counter[2:4] is the stream
+    std::array<std::uint32_t, 4> counter;
+    std::array<std::uint32_t, 4> block;
+    unsigned int blockIdx = 4;  // next unused output in block
+};
+
+} // namespace util
+
+#endif
@@ -1,8 +1,10 @@
 #ifndef SCENARIO_H
 #define SCENARIO_H
 
+#include <assert.h>
 #include <memory>
 #include "base.h"
+#include "snapshot.h"
 
 class Scenario {
     /**
@@ -16,6 +18,19 @@ public:
     Scenario() {}
     virtual ~Scenario() {}
     virtual std::shared_ptr<Economy> setup() = 0;
+
+    // sets up a new economy & copies economy's current state into it, so the two can continue independently
+    // economy should have been set up by this scenario & be between time steps
+    // this costs a setup() plus a restore, so it saves re-running the steps economy has taken, not setting it up
+    // NeuralScenarios share one DecisionNetHandler, which setup() points at the new economy: a neural fork takes over
+    // the handler, so the original (or any other economy from the same scenario) mustn't step until it's done
+    std::shared_ptr<Economy> fork(const Economy& economy) {
+        std::shared_ptr<Economy> copy = setup();
+        bool restored = EconomySnapshot(economy).restore(*copy);
+        assert(restored);
+        (void)restored;
+        return copy;
+    }
 };
 
 #endif
\ No newline at end of file
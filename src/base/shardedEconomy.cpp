@@ -0,0 +1,476 @@
+#include <assert.h>
+#include <algorithm>
+#include <csignal>
+#include <cstdio>
+#include <cstring>
+#include <unordered_map>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include "shardedEconomy.h"
+#include "shmRing.h"
+
+
+namespace {
+
+class Consignee : public Person {
+    // stands in for the sellers of other shards, listing the units they've consigned to this shard
+public:
+    template <typename T, typename ... Args>
+    friend std::shared_ptr<T> util::create(Args&& ... args);
+
+    std::string get_typename() const override { return "Consignee"; }
+
+protected:
+    Consignee(Economy* economy) : Person(economy) {}
+};
+
+struct ShardInfo {
+    // what each shard's setup produced; shards only go ahead if these all match
+    std::uint32_t numGoods;
+    std::uint32_t numAgents;
+};
+
+// units of an offer shipped to another shard; followed by the offer's quantities
+struct ConsignmentRecord {
+    std::uint64_t key;
+    std::uint32_t amount;
+    std::uint32_t padding;
+    double price;
+};
+
+// what became of a consignment, sent back to its seller's shard
+struct SettlementRecord {
+    std::uint64_t key;
+    std::uint32_t sold;
+    std::uint32_t returned;
+};
+
+struct ResultRecord {
+    std::uint32_t time;
+    std::uint32_t numAgents;
+    double money;
+    // followed by the shard's total inventory
+};
+
+// a consignment received from another shard & listed on this one
+struct Listing {
+    unsigned int source;
+    std::uint64_t key;
+    OfferHandle offer;
+    unsigned int amount;
+};
+
+std::size_t round_up(std::size_t size) {
+    return (size + 63) / 64 * 64;
+}
+
+struct Layout {
+    // where everything is in the shared memory segment
+    // ring (i, j) carries records from shard i to shard j
+    Layout(unsigned int numShards, unsigned int numGoods, unsigned int ringCapacity) :
+        numShards(numShards),
+        consignmentSize(sizeof(ConsignmentRecord) + numGoods * sizeof(double)),
+        consignmentRingSize(round_up(ShmRing::get_size(ringCapacity, consignmentSize))),
+        settlementRingSize(round_up(ShmRing::get_size(ringCapacity, sizeof(SettlementRecord)))),
+        resultSize(round_up(sizeof(ResultRecord) + numGoods * sizeof(double))) {}
+
+    std::size_t consignment_ring(unsigned int from, unsigned int to) const {
+        return (from * numShards + to) * consignmentRingSize;
+    }
+    std::size_t settlement_ring(unsigned int from, unsigned int to) const {
+        return numShards * numShards * consignmentRingSize + (from * numShards + to) * settlementRingSize;
+    }
+    std::size_t result(unsigned int shard) const {
+        return numShards * numShards * (consignmentRingSize + settlementRingSize) + shard * resultSize;
+    }
+    std::size_t get_size() const { return result(numShards); }
+
+    unsigned int numShards;
+    unsigned int consignmentSize;
+    std::size_t consignmentRingSize;
+    std::size_t settlementRingSize;
+    std::size_t resultSize;
+};
+
+} // namespace
+
+
+struct ShardedEconomy::Control {
+    // set up before forking, in memory every process shares
+    pthread_barrier_t barrier;
+    std::atomic<bool> failed{false};
+    char segmentName[64];  // of the POSIX shared memory object holding the rings
+
+    ShardInfo* get_infos() { return reinterpret_cast<ShardInfo*>(this + 1); }
+    void wait() { pthread_barrier_wait(&barrier); }
+};
+
+struct ShardedEconomy::Consignment {
+    // the seller's side of units consigned to other shards
+    OfferHandle offer;
+    Agent* offerer;
+    double price;
+    Goods quantities;
+};
+
+
+ShardedEconomy::ShardedEconomy(
+    std::shared_ptr<Scenario> scenario,
+    unsigned int numShards,
+    unsigned int ringCapacity
+) : scenario(scenario),
+    numShards((numShards > 0) ? numShards : 1),
+    ringCapacity((ringCapacity > 0) ? ringCapacity : 1) {}
+
+
+bool ShardedEconomy::run(unsigned int numSteps) {
+    if (done) {
+        return false;
+    }
+    done = true;
+    std::size_t controlSize = sizeof(Control) + numShards * sizeof(ShardInfo);
+    void* memory = mmap(nullptr, controlSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (memory == MAP_FAILED) {
+        return false;
+    }
+    Control* control = new (memory) Control();
+    pthread_barrierattr_t attr;
+    pthread_barrierattr_init(&attr);
+    pthread_barrierattr_setpshared(&attr, PTHREAD_PROCESS_SHARED);
+    pthread_barrier_init(&control->barrier, &attr, numShards);
+    pthread_barrierattr_destroy(&attr);
+    std::snprintf(control->segmentName, sizeof(control->segmentName), "/fastACE.%d.%p", getpid(), memory);
+
+    // otherwise anything still buffered would be printed once per process
+    std::cout.flush();
+    std::fflush(nullptr);
+    std::vector<pid_t> workers;
+    for (unsigned int shard = 1; shard < numShards; shard++) {
+        pid_t pid = fork();
+        if (pid == 0) {
+            bool ok = run_shard(control, shard, numSteps);
+            std::cout.flush();
+            std::fflush(nullptr);
+            _exit(ok ? 0 : 1);
+        }
+        if (pid < 0) {
+            // the barrier expects every shard, so the ones already started can't finish
+            for (pid_t worker : workers) {
+                kill(worker, SIGKILL);
+                waitpid(worker, nullptr, 0);
+            }
+            pthread_barrier_destroy(&control->barrier);
+            munmap(memory, controlSize);
+            return false;
+        }
+        workers.push_back(pid);
+    }
+    bool ok = run_shard(control, 0, numSteps);
+    for (pid_t worker : workers) {
+        int status = 0;
+        if (waitpid(worker, &status, 0) < 0 || !WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+            ok = false;
+        }
+    }
+    pthread_barrier_destroy(&control->barrier);
+    munmap(memory, controlSize);
+    return ok;
+}
+
+
+bool ShardedEconomy::run_shard(Control* control, unsigned int shard, unsigned int numSteps) {
+    // every shard goes through the same sequence of barriers whether or not anything has failed,
+    // so that a failure in one shard can't leave the others waiting
+    economy = scenario->setup();
+    ShardInfo* infos = control->get_infos();
+    infos[shard] = ShardInfo{economy->get_numGoods(), static_cast<std::uint32_t>(economy->persons.size() + economy->firms.size())};
+    control->wait();
+    for (unsigned int i = 0; i < numShards; i++) {
+        if (infos[i].numGoods != infos[shard].numGoods || infos[i].numAgents != infos[shard].numAgents) {
+            control->failed = true;
+        }
+    }
+    unsigned int numGoods = economy->get_numGoods();
+    Layout layout(numShards, numGoods, ringCapacity);
+
+    // shard 0 creates the segment, the others map it once it's there, and it's unlinked once everyone has it
+    char* segment = nullptr;
+    if (shard == 0 && !control->failed) {
+        int fd = shm_open(control->segmentName, O_CREAT | O_EXCL | O_RDWR, 0600);
+        if (fd >= 0 && ftruncate(fd, layout.get_size()) == 0) {
+            void* memory = mmap(nullptr, layout.get_size(), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+            if (memory != MAP_FAILED) {
+                segment = static_cast<char*>(memory);
+                for (unsigned int i = 0; i < numShards; i++) {
+                    for (unsigned int j = 0; j < numShards; j++) {
+                        ShmRing::init(segment + layout.consignment_ring(i, j), ringCapacity, layout.consignmentSize);
+                        ShmRing::init(segment + layout.settlement_ring(i, j), ringCapacity, sizeof(SettlementRecord));
+                    }
+                }
+            }
+        }
+        if (fd >= 0) {
+            close(fd);
+        }
+        if (segment == nullptr) {
+            control->failed = true;
+        }
+    }
+    control->wait();
+    if (shard != 0 && !control->failed) {
+        int fd = shm_open(control->segmentName, O_RDWR, 0);
+        if (fd >= 0) {
+            void* memory = mmap(nullptr, layout.get_size(), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+            if (memory != MAP_FAILED) {
+                segment = static_cast<char*>(memory);
+            }
+            close(fd);
+        }
+        if (segment == nullptr) {
+            control->failed = true;
+        }
+    }
+    control->wait();
+    if (shard == 0) {
+        shm_unlink(control->segmentName);
+    }
+    if (!control->failed && !keep_shard(shard)) {
+        control->failed = true;
+    }
+
+    // rings to & from each other shard
+    std::vector<ShmRing> consignmentsOut(numShards), consignmentsIn(numShards);
+    std::vector<ShmRing> settlementsOut(numShards), settlementsIn(numShards);
+    if (segment != nullptr) {
+        for (unsigned int i = 0; i < numShards; i++) {
+            consignmentsOut[i] = ShmRing(segment + layout.consignment_ring(shard, i));
+            consignmentsIn[i] = ShmRing(segment + layout.consignment_ring(i, shard));
+            settlementsOut[i] = ShmRing(segment + layout.settlement_ring(shard, i));
+            settlementsIn[i] = ShmRing(segment + layout.settlement_ring(i, shard));
+        }
+    }
+    // a record's fields are copied in & out, so a buffer of doubles keeps the quantities aligned
+    static_assert(sizeof(ConsignmentRecord) % sizeof(double) == 0, "quantities must follow the record aligned");
+    std::vector<double> record(layout.consignmentSize / sizeof(double));
+    ConsignmentRecord header;
+    std::unordered_map<std::uint64_t, Consignment> consigned;
+    std::vector<Listing> listings;
+    Agent* local = consignee.get();
+
+    for (unsigned int step = 0; step < numSteps; step++) {
+        // ship a share of every open offer to each other shard
+        if (!control->failed && crossShardTrade) {
+            economy->market.for_each(
+                [&](OfferHandle handle, const Offer&) {
+                    Offer* offer = economy->market.get(handle);
+                    if (!offer->is_available() || offer->offerer == local) {
+                        return;
+                    }
+                    Agent* seller = offer->offerer;
+                    unsigned int amount = offer->amountLeft;
+                    // never ship more than the seller has on hand
+                    unsigned int coverable = util::get_coverable(seller->inventory, offer->quantities, amount);
+                    // every shard gets amount / numShards units, and the remainder goes round the shards in turn
+                    unsigned int first = (offer->key + economy->time) % numShards;
+                    unsigned int numConsigned = 0;
+                    for (unsigned int i = 0; i < numShards; i++) {
+                        unsigned int share = amount / numShards + ((i + numShards - first) % numShards < amount % numShards);
+                        share = std::min(share, coverable - numConsigned);
+                        if (i == shard || share == 0) {
+                            continue;
+                        }
+                        header = ConsignmentRecord{offer->key, share, 0, offer->price};
+                        std::memcpy(record.data(), &header, sizeof(header));
+                        std::memcpy(record.data() + sizeof(header) / sizeof(double), offer->quantities.data(), numGoods * sizeof(double));
+                        if (consignmentsOut[i].push(record.data())) {
+                            numConsigned += share;
+                        }
+                    }
+                    if (numConsigned == 0) {
+                        return;
+                    }
+                    // the goods leave with the units, so they no longer need covering here
+                    unsigned int removed = 0;
+                    if (offer->limit_amountLeft(amount - numConsigned, removed) == 0) {
+                        economy->retire_offer(handle);
+                    }
+                    economy->record_withdrawal(*offer, removed);
+                    seller->inventory -= offer->quantities * numConsigned;
+                    seller->committedInventory -= offer->quantities * numConsigned;
+                    consigned[offer->key] = Consignment{handle, seller, offer->price, offer->quantities};
+                }
+            );
+        }
+        control->wait();
+
+        if (!control->failed) {
+            // list what the other shards shipped here
+            for (unsigned int i = 0; i < numShards; i++) {
+                while (i != shard && consignmentsIn[i].pop(record.data())) {
+                    std::memcpy(&header, record.data(), sizeof(header));
+                    Eigen::Map<const Eigen::ArrayXd> quantities(record.data() + sizeof(header) / sizeof(double), numGoods);
+                    local->inventory += quantities * header.amount;
+                    OfferHandle handle = local->post_offer(header.amount, quantities, header.price);
+                    listings.push_back(Listing{i, header.key, handle, header.amount});
+                }
+            }
+            if (!economy->begin_step()) {
+                control->failed = true;
+            }
+            else {
+                economy->step_agents();
+                // report what sold & ship back the rest; listings are still on the market until end_step
+                local->settle_offers();
+                for (const auto& listing : listings) {
+                    Offer* offer = economy->market.get(listing.offer);
+                    unsigned int left = (offer != nullptr) ? offer->amountLeft.exchange(0) : 0;
+                    if (left > 0) {
+                        economy->record_withdrawal(*offer, left);
+                        economy->retire_offer(listing.offer);
+                    }
+                    SettlementRecord settlement{listing.key, listing.amount - left, left};
+                    // can't fail, since the ring holds as many records as could have been consigned
+                    bool pushed = settlementsOut[listing.source].push(&settlement);
+                    assert(pushed);
+                    (void)pushed;
+                }
+                // the proceeds & unsold goods are now in transit, so the consignee is left empty
+                {
+                    std::lock_guard<std::mutex> lock(local->myMutex);
+                    local->money = 0.0;
+                    local->inventory.setZero();
+                    local->committedInventory.setZero();
+                    local->myOffers.clear();
+                    local->numRetiredOffers = 0;
+                }
+                listings.clear();
+                economy->end_step();
+            }
+        }
+        control->wait();
+
+        if (!control->failed) {
+            // pay sellers for what sold elsewhere & give them back the rest
+            SettlementRecord settlement;
+            for (unsigned int i = 0; i < numShards; i++) {
+                while (i != shard && settlementsIn[i].pop(&settlement)) {
+                    auto search = consigned.find(settlement.key);
+                    if (search == consigned.end()) {
+                        continue;
+                    }
+                    const Consignment& consignment = search->second;
+                    Agent* seller = consignment.offerer;
+                    seller->money += consignment.price * settlement.sold;
+                    seller->inventory += consignment.quantities * settlement.returned;
+                    Offer* offer = economy->market.get(consignment.offer);
+                    if (offer != nullptr) {
+                        offer->amountTaken += settlement.sold;
+                        // returned units go back on the offer, unless it's been withdrawn or sold out since
+                        if (settlement.returned > 0 && offer->is_available()) {
+                            offer->amountLeft += settlement.returned;
+                            seller->committedInventory += consignment.quantities * settlement.returned;
+                            if (economy->marketStats != nullptr) {
+                                economy->marketStats->record_post(consignment.quantities, settlement.returned);
+                            }
+                        }
+                    }
+                }
+            }
+            consigned.clear();
+        }
+    }
+
+    if (segment != nullptr && !control->failed) {
+        ResultRecord result{economy->get_time(), static_cast<std::uint32_t>(economy->persons.size() + economy->firms.size() - 1), 0.0};
+        // the consignee is empty between steps, so it doesn't change the totals
+        result.money = economy->get_total_money();
+        Eigen::ArrayXd inventory = economy->get_total_inventory();
+        std::memcpy(segment + layout.result(shard), &result, sizeof(result));
+        std::memcpy(segment + layout.result(shard) + sizeof(result), inventory.data(), numGoods * sizeof(double));
+    }
+    control->wait();
+    if (shard == 0 && segment != nullptr && !control->failed) {
+        stats.resize(numShards);
+        for (unsigned int i = 0; i < numShards; i++) {
+            ResultRecord result;
+            std::memcpy(&result, segment + layout.result(i), sizeof(result));
+            stats[i].time = result.time;
+            stats[i].numAgents = result.numAgents;
+            stats[i].money = result.money;
+            stats[i].inventory.resize(numGoods);
+            std::memcpy(stats[i].inventory.data(), segment + layout.result(i) + sizeof(result), numGoods * sizeof(double));
+        }
+    }
+    if (segment != nullptr) {
+        munmap(segment, layout.get_size());
+    }
+    return !control->failed;
+}
+
+
+bool ShardedEconomy::keep_shard(unsigned int shard) {
+    if (economy->get_numRegions() == 1) {
+        if (numShards > 1 && !economy->set_numRegions(numShards)) {
+            return false;
+        }
+    }
+    else if (economy->get_numRegions() != numShards) {
+        return false;
+    }
+    crossShardTrade = economy->get_crossRegionTrade();
+    // added before the others are dropped, so its id doesn't clash with theirs
+    consignee = util::create<Consignee>(economy.get());
+    economy->set_region(consignee.get(), shard);
+
+    // dropped agents are emptied, so that totals over everything (e.g. in an AgentStateStore) only count this shard,
+    // but kept alive, since firms & the state store may still point at them
+    auto drop = [&](std::shared_ptr<Agent> agent) {
+        if (agent->get_region() == shard) {
+            return false;
+        }
+        agent->money = 0.0;
+        agent->inventory.setZero();
+        others.push_back(agent);
+        return true;
+    };
+    auto& persons = economy->persons;
+    persons.erase(std::remove_if(persons.begin(), persons.end(), drop), persons.end());
+    auto& firms = economy->firms;
+    firms.erase(std::remove_if(firms.begin(), firms.end(), drop), firms.end());
+    economy->persons_weak.assign(persons.begin(), persons.end());
+    economy->firms_weak.assign(firms.begin(), firms.end());
+    economy->recount_caughtUp();
+    // back to one region, so this shard's agents use the whole thread pool;
+    // if setup posted offers this fails & the shard's agents stay in their (single) region, which still works
+    economy->set_numRegions(1);
+    return true;
+}
+
+
+std::shared_ptr<Economy> ShardedEconomy::get_economy() const { return economy; }
+
+unsigned int ShardedEconomy::get_numShards() const { return numShards; }
+
+const std::vector<ShardStats>& ShardedEconomy::get_stats() const { return stats; }
+
+double ShardedEconomy::get_total_money() const {
+    double total = 0.0;
+    for (const auto& shardStats : stats) {
+        total += shardStats.money;
+    }
+    return total;
+}
+
+Eigen::ArrayXd ShardedEconomy::get_total_inventory() const {
+    if (stats.empty()) {
+        return Eigen::ArrayXd();
+    }
+    Eigen::ArrayXd total = Eigen::ArrayXd::Zero(stats[0].inventory.size());
+    for (const auto& shardStats : stats) {
+        total += shardStats.inventory;
+    }
+    return total;
+}
@@ -0,0 +1,88 @@
+#ifndef SHARDED_ECONOMY_H
+#define SHARDED_ECONOMY_H
+
+#include <memory>
+#include <string>
+#include <vector>
+#include <Eigen/Dense>
+#include "scenario.h"
+
+
+struct ShardStats {
+    // the state of one shard's agents after a ShardedEconomy run
+    unsigned int time = 0;
+    unsigned int numAgents = 0;
+    double money = 0.0;
+    Eigen::ArrayXd inventory;
+};
+
+
+class ShardedEconomy {
+    /**
+     * Runs one economy split across several local processes, each owning a shard of its persons and firms.
+     *
+     * Each process sets up the economy from the same Scenario, so setup should be deterministic (e.g. a fixed seed).
+     * Shards are the economy's regions (see Economy::set_numRegions): an economy set up with numShards regions
+     * keeps its own assignment, and one set up with a single region is split by agent id.
+     * Each process keeps only its own region's agents and steps them with its own thread pool;
+     * the labor market is local to each shard.
+     *
+     * Goods trade across shards by consignment, unless the scenario turned cross-region trade off.
+     * Between time steps, each shard splits the units still left on its offers evenly between all shards
+     * and ships the other shards' units, with the goods to cover them, through POSIX shared memory ring buffers.
+     * Each receiving shard lists them on its own market under a local stand-in seller, so buyers there take them
+     * like any other offer, in any clearing mode. After the step, the sales & any unsold goods are sent back
+     * and settled with the original sellers. All shards wait on a process-shared barrier twice per step,
+     * and no goods or money are left in transit between steps.
+     *
+     * run forks the worker processes, so it should be called while the process isn't running other threads.
+     * If a worker process dies, the others will block at the next barrier.
+     * Dividends paid to owners in other shards go to those owners' local copies, which aren't stepped,
+     * so firms' owners should be in the same shard.
+     */
+public:
+    // ringCapacity is the most offers one shard can consign to another in a step; any more stay local
+    ShardedEconomy(
+        std::shared_ptr<Scenario> scenario,
+        unsigned int numShards,
+        unsigned int ringCapacity = 1 << 16
+    );
+
+    // steps every shard numSteps times, then collects each shard's totals
+    // the calling process runs shard 0 and keeps its part of the economy (see get_economy)
+    // returns false if any shard failed, e.g. because the shards' setups didn't match
+    // can only be called once
+    bool run(unsigned int numSteps);
+
+    // shard 0's part of the economy, after run
+    std::shared_ptr<Economy> get_economy() const;
+    unsigned int get_numShards() const;
+    // indexed by shard; filled in by run
+    const std::vector<ShardStats>& get_stats() const;
+    double get_total_money() const;
+    Eigen::ArrayXd get_total_inventory() const;
+
+private:
+    struct Control;
+    struct Consignment;
+
+    // everything one process does during run
+    bool run_shard(Control* control, unsigned int shard, unsigned int numSteps);
+    // drops every agent outside shard from economy & adds the consignee
+    // returns false if the economy can't be split into numShards
+    bool keep_shard(unsigned int shard);
+
+    std::shared_ptr<Scenario> scenario;
+    unsigned int numShards;
+    unsigned int ringCapacity;
+    bool done = false;
+    std::shared_ptr<Economy> economy;
+    // lists other shards' consignments on this shard's market
+    std::shared_ptr<Person> consignee;
+    // agents of other shards, kept alive since firms & the state store may still point at them
+    std::vector<std::shared_ptr<Agent>> others;
+    bool crossShardTrade = true;
+    std::vector<ShardStats> stats;
+};
+
+#endif
@@ -0,0 +1,79 @@
+#ifndef SHM_RING_H
+#define SHM_RING_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <new>
+
+
+class ShmRing {
+    /**
+     * A single-producer, single-consumer queue of fixed-size records, laid out in memory
+     * that may be shared between processes (e.g. a POSIX shared memory object mapped by each of them).
+     *
+     * The ring doesn't own its memory; it's a view that any process can attach to once one of them has set it up.
+     * Head & tail are lock-free atomics, which work across processes since they don't depend on their address.
+     */
+public:
+    static_assert(std::atomic<std::uint64_t>::is_always_lock_free, "rings shared between processes need lock-free counters");
+
+    // bytes of memory needed for a ring
+    static std::size_t get_size(unsigned int capacity, unsigned int recordSize) {
+        return sizeof(Header) + std::size_t(capacity) * recordSize;
+    }
+
+    // sets up an empty ring in memory, which must be at least get_size bytes & aligned to 64 bytes
+    // should be done by one process before any process attaches to it
+    static ShmRing init(void* memory, unsigned int capacity, unsigned int recordSize) {
+        Header* header = new (memory) Header();
+        header->capacity = capacity;
+        header->recordSize = recordSize;
+        return ShmRing(memory);
+    }
+
+    ShmRing() {}
+    // attaches to a ring set up with init
+    explicit ShmRing(void* memory) :
+        header(static_cast<Header*>(memory)), records(static_cast<char*>(memory) + sizeof(Header)) {}
+
+    // producer side; returns false if the ring is full
+    bool push(const void* record) {
+        std::uint64_t tail = header->tail.load(std::memory_order_relaxed);
+        if (tail - header->head.load(std::memory_order_acquire) == header->capacity) {
+            return false;
+        }
+        std::memcpy(records + (tail % header->capacity) * header->recordSize, record, header->recordSize);
+        header->tail.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    // consumer side; returns false if the ring is empty
+    bool pop(void* record) {
+        std::uint64_t head = header->head.load(std::memory_order_relaxed);
+        if (head == header->tail.load(std::memory_order_acquire)) {
+            return false;
+        }
+        std::memcpy(record, records + (head % header->capacity) * header->recordSize, header->recordSize);
+        header->head.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    unsigned int get_capacity() const { return header->capacity; }
+    unsigned int get_recordSize() const { return header->recordSize; }
+
+private:
+    struct Header {
+        // on separate cache lines, since they're written by different processes
+        alignas(64) std::atomic<std::uint64_t> head{0};
+        alignas(64) std::atomic<std::uint64_t> tail{0};
+        std::uint32_t capacity = 0;
+        std::uint32_t recordSize = 0;
+    };
+
+    Header* header = nullptr;
+    char* records = nullptr;
+};
+
+#endif
@@ -0,0 +1,300 @@
+#ifndef SLOT_MAP_H
+#define SLOT_MAP_H
+
+#include <assert.h>
+#include <algorithm>
+#include <atomic>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include "perThread.h"
+
+
+template <typename T>
+struct Handle {
+    // refers to an object in a SlotMap<T>
+    // a handle goes stale when its object is erased, even if the slot is later reused,
+    // since the slot's generation will no longer match
+    unsigned int index = std::numeric_limits<unsigned int>::max();
+    unsigned int generation = 0;
+
+    bool operator==(const Handle& other) const {
+        return index == other.index && generation == other.generation;
+    }
+    bool operator!=(const Handle& other) const { return !(*this == other); }
+};
+
+
+template <typename T>
+class SlotMap {
+    /**
+     * Owns a set of objects of type T and refers to them by generational Handle.
+     *
+     * Objects live in fixed-size blocks that are never moved, so pointers obtained from get()
+     * stay valid until the object is erased, and iteration walks contiguous memory.
+     * Checking whether a handle is still valid is O(1) and takes no locks: just two acquire loads (the shard's slot count
+     * & the slot's occupied flag) and a comparison of generations.
+     *
+     * The map can be split into shards (e.g. one per market region), each with its own blocks, free list & lock,
+     * so that threads inserting into different shards never contend. A handle's shard is kept in the high bits
+     * of its index, so handles from every shard work with get() as usual.
+     *
+     * Each thread reserves slots from a shard RESERVE_SIZE at a time, so insert() only takes the shard's lock
+     * once every RESERVE_SIZE inserts; slots a thread has reserved but not yet used are left out of for_each
+     * like any other empty slot. erase_if() and set_numShards() take back every thread's unused reservations,
+     * so slots reserved by a thread that has since exited aren't lost. A single thread gets the same slots,
+     * in the same order, as it would one at a time, except that slots it reserved before an erase_if
+     * are used up before the slots that erase_if freed.
+     *
+     * insert() may be called from several threads at once.
+     * get() and for_each() may run concurrently with insert(),
+     * but erase_if() and set_numShards() should only be called when nothing else is using the SlotMap
+     * (in the economy this is the end of a time step).
+     *
+     * Objects that are dead but not yet erased can be counted as tombstones (see add_tombstone),
+     * so that the owner only pays for an erase_if sweep once enough of the map is dead.
+     */
+public:
+    static const unsigned int BLOCK_SIZE = 1024;
+    static const unsigned int MAX_BLOCKS = 4096;
+    // slot indices within a shard take up the low SHARD_SHIFT bits of a handle's index
+    static const unsigned int SHARD_SHIFT = 22;
+    // one short of what the bits allow, so that a default constructed handle is never valid
+    static const unsigned int MAX_SHARDS = (1u << (32 - SHARD_SHIFT)) - 1;
+    static_assert(BLOCK_SIZE * MAX_BLOCKS <= (1u << SHARD_SHIFT), "slot indices must fit below the shard bits");
+    // slots a thread takes from a shard whenever it runs out
+    static const unsigned int RESERVE_SIZE = 32;
+
+    SlotMap() {
+        shards.push_back(std::unique_ptr<Shard>(new Shard()));
+    }
+
+    SlotMap(const SlotMap&) = delete;
+    SlotMap& operator=(const SlotMap&) = delete;
+
+    // only allowed while the map is empty (and nobody is inserting)
+    void set_numShards(unsigned int numShards) {
+        assert(numShards > 0 && numShards <= MAX_SHARDS && size() == 0);
+        // hand back the slots threads have reserved, so none are lost with a removed shard
+        reclaim_reservations();
+        shards.resize(numShards);
+        for (auto& shard : shards) {
+            if (shard == nullptr) {
+                shard = std::unique_ptr<Shard>(new Shard());
+            }
+        }
+    }
+    unsigned int get_numShards() const { return shards.size(); }
+
+    // shard of the object a handle refers to; only meaningful for handles returned by this map
+    static unsigned int get_shard(Handle<T> handle) { return handle.index >> SHARD_SHIFT; }
+
+    Handle<T> insert(const T& value, unsigned int shard = 0) {
+        // assigning into the existing object lets T reuse any memory it already holds
+        return emplace([&value](T& slotValue) { slotValue = value; }, shard);
+    }
+
+    // like insert, but init(value) sets up the new object in place
+    // value is whatever the slot's previous occupant left behind (or default constructed if the slot is new),
+    // so init must overwrite every member; in return, memory the old object held (e.g. an Eigen array)
+    // can be reused instead of reallocated. Erased slots are reused most recent first, while their memory is still warm
+    template <typename F>
+    Handle<T> emplace(F init, unsigned int shard = 0) {
+        assert(shard < shards.size());
+        Shard& s = *shards[shard];
+        Reservation& reservation = reservations.local();
+        if (reservation.reserved.size() <= shard) {
+            reservation.reserved.resize(shards.size());
+        }
+        std::vector<unsigned int>& reserved = reservation.reserved[shard];
+        if (reserved.empty()) {
+            s.reserve(reserved);
+        }
+        unsigned int index = reserved.back();
+        reserved.pop_back();
+        Slot& slot = s.get_slot(index);
+        init(slot.value);
+        // readers check occupied before touching value, so publish it last
+        slot.occupied.store(true, std::memory_order_release);
+        s.numLive++;
+        return Handle<T>{(shard << SHARD_SHIFT) | index, slot.generation};
+    }
+
+    // returns nullptr if the handle is stale
+    T* get(Handle<T> handle) {
+        return const_cast<T*>(static_cast<const SlotMap*>(this)->get(handle));
+    }
+
+    const T* get(Handle<T> handle) const {
+        unsigned int shard = get_shard(handle);
+        if (shard >= shards.size()) {
+            return nullptr;
+        }
+        const Shard& s = *shards[shard];
+        unsigned int index = handle.index & SLOT_MASK;
+        if (index >= s.numSlots.load(std::memory_order_acquire)) {
+            return nullptr;
+        }
+        const Slot& slot = s.get_slot(index);
+        if (!slot.occupied.load(std::memory_order_acquire) || slot.generation != handle.generation) {
+            return nullptr;
+        }
+        return &slot.value;
+    }
+
+    bool contains(Handle<T> handle) const {
+        return get(handle) != nullptr;
+    }
+
+    // calls f(handle, value) for each object, in shard order then slot order
+    template <typename F>
+    void for_each(F f) const {
+        for (unsigned int shard = 0; shard < shards.size(); shard++) {
+            for_each_in(shard, f);
+        }
+    }
+
+    // calls f(handle, value) for each object in one shard, in slot order
+    template <typename F>
+    void for_each_in(unsigned int shard, F f) const {
+        const Shard& s = *shards[shard];
+        unsigned int n = s.numSlots.load(std::memory_order_acquire);
+        for (unsigned int i = 0; i < n; i++) {
+            const Slot& slot = s.get_slot(i);
+            if (slot.occupied.load(std::memory_order_acquire)) {
+                f(Handle<T>{(shard << SHARD_SHIFT) | i, slot.generation}, slot.value);
+            }
+        }
+    }
+
+    // erases every object for which pred(value) is true; their handles become stale
+    // also returns every thread's reserved slots to the free lists
+    // erased objects aren't destroyed, so their slots (and any memory they own) are recycled by later inserts
+    // resets the tombstone count, so pred should match every object that was counted as a tombstone
+    template <typename Pred>
+    void erase_if(Pred pred) {
+        for (auto& shard : shards) {
+            Shard& s = *shard;
+            std::lock_guard<std::mutex> lock(s.mutex);
+            unsigned int n = s.numSlots.load(std::memory_order_relaxed);
+            for (unsigned int i = 0; i < n; i++) {
+                Slot& slot = s.get_slot(i);
+                if (slot.occupied.load(std::memory_order_relaxed) && pred(static_cast<const T&>(slot.value))) {
+                    slot.occupied.store(false, std::memory_order_relaxed);
+                    slot.generation++;
+                    s.freeList.push_back(i);
+                    s.numLive--;
+                }
+            }
+            s.numTombstones.store(0, std::memory_order_relaxed);
+        }
+        // take back the slots threads have reserved, so none are stranded with a thread that has exited
+        // they go on top of the slots just freed, so each thread still gets them next, in the same order
+        reclaim_reservations();
+    }
+
+    // records that one of the objects held (in the given shard) has died & is only waiting to be erased
+    // dead objects are still returned by get() and for_each() until they're erased
+    // thread safe; the count is only used to decide when to sweep, so it doesn't need to be exact
+    void add_tombstone(unsigned int shard = 0) { shards[shard]->numTombstones.fetch_add(1, std::memory_order_relaxed); }
+    unsigned int get_numTombstones() const {
+        unsigned int total = 0;
+        for (const auto& shard : shards) {
+            total += shard->numTombstones.load(std::memory_order_relaxed);
+        }
+        return total;
+    }
+    // whether more than maxRatio of the objects held are tombstones
+    bool needs_compaction(double maxRatio) const {
+        return get_numTombstones() > maxRatio * size();
+    }
+
+    // number of objects currently held, including tombstones
+    unsigned int size() const {
+        unsigned int total = 0;
+        for (const auto& shard : shards) {
+            total += shard->numLive.load(std::memory_order_relaxed);
+        }
+        return total;
+    }
+    unsigned int size_of(unsigned int shard) const { return shards[shard]->numLive.load(std::memory_order_relaxed); }
+
+private:
+    static const unsigned int SLOT_MASK = (1u << SHARD_SHIFT) - 1;
+
+    struct Slot {
+        T value;
+        unsigned int generation = 0;
+        std::atomic<bool> occupied{false};
+    };
+
+    struct Shard {
+        Shard() {
+            // reserving up front means that adding a block never moves the other block pointers
+            blocks.reserve(MAX_BLOCKS);
+        }
+
+        Slot& get_slot(unsigned int index) {
+            return blocks[index / BLOCK_SIZE][index % BLOCK_SIZE];
+        }
+
+        const Slot& get_slot(unsigned int index) const {
+            return blocks[index / BLOCK_SIZE][index % BLOCK_SIZE];
+        }
+
+        // refills a thread's empty reservation, next slot to use at the back
+        void reserve(std::vector<unsigned int>& reserved) {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (!freeList.empty()) {
+                // the most recently freed, in the same order, so they're still reused most recent first
+                std::size_t n = std::min<std::size_t>(RESERVE_SIZE, freeList.size());
+                reserved.assign(freeList.end() - n, freeList.end());
+                freeList.resize(freeList.size() - n);
+                return;
+            }
+            unsigned int first = numSlots.load(std::memory_order_relaxed);
+            unsigned int n = std::min(RESERVE_SIZE, BLOCK_SIZE * MAX_BLOCKS - first);
+            assert(n > 0);
+            while ((first + n - 1) / BLOCK_SIZE >= blocks.size()) {
+                blocks.push_back(std::unique_ptr<Slot[]>(new Slot[BLOCK_SIZE]));
+            }
+            for (unsigned int i = n; i-- > 0;) {
+                reserved.push_back(first + i);
+            }
+            // the new slots are empty, so readers can already walk over them
+            numSlots.store(first + n, std::memory_order_release);
+        }
+
+        std::vector<std::unique_ptr<Slot[]>> blocks;
+        // one past the highest slot index ever reserved
+        std::atomic<unsigned int> numSlots{0};
+        std::atomic<unsigned int> numLive{0};
+        std::atomic<unsigned int> numTombstones{0};
+        std::vector<unsigned int> freeList;
+        std::mutex mutex;  // protects blocks & freeList
+    };
+
+    // slots each thread has reserved, per shard
+    struct Reservation {
+        std::vector<std::vector<unsigned int>> reserved;
+    };
+
+    // moves every thread's reserved slots back onto their shards' free lists
+    // only safe while nobody is inserting
+    void reclaim_reservations() {
+        reservations.for_each([this](Reservation& reservation) {
+            for (unsigned int shard = 0; shard < reservation.reserved.size() && shard < shards.size(); shard++) {
+                std::vector<unsigned int>& reserved = reservation.reserved[shard];
+                std::vector<unsigned int>& freeList = shards[shard]->freeList;
+                freeList.insert(freeList.end(), reserved.begin(), reserved.end());
+            }
+            reservation.reserved.clear();
+        });
+    }
+
+    std::vector<std::unique_ptr<Shard>> shards;
+    PerThread<Reservation> reservations;
+};
+
+#endif
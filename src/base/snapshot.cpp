@@ -0,0 +1,459 @@
+#include <algorithm>
+#include <cstring>
+#include <type_traits>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "snapshot.h"
+
+
+namespace {
+
+const char MAGIC[8] = {'f', 'a', 's', 't', 'A', 'C', 'E', 's'};
+const std::uint32_t VERSION = 1;
+
+// random streams are copied byte for byte
+static_assert(std::is_trivially_copyable<util::Philox>::value, "Philox must be trivially copyable");
+
+struct OfferRecord {
+    std::uint32_t offerer;  // agent id
+    std::uint32_t amountLeft;
+    std::uint32_t amountTaken;
+    std::uint32_t padding = 0;
+    std::uint64_t key;
+    double price;
+};
+
+struct JobOfferRecord {
+    std::uint32_t offerer;
+    std::uint32_t amountLeft;
+    std::uint32_t amountTaken;
+    std::uint32_t padding = 0;
+    std::uint64_t key;
+    double labor;
+    double wage;
+};
+
+// FNV-1a, so that hashes don't depend on the standard library
+std::uint64_t hash_typename(const std::string& name) {
+    std::uint64_t hash = 14695981039346656037ull;
+    for (char c : name) {
+        hash ^= static_cast<unsigned char>(c);
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+template <typename T>
+void write(std::vector<char>& data, const T* values, std::size_t n) {
+    const char* bytes = reinterpret_cast<const char*>(values);
+    data.insert(data.end(), bytes, bytes + n * sizeof(T));
+}
+
+class Reader {
+    // reads successive columns out of a snapshot; values are memcpy'd since columns needn't be aligned
+public:
+    Reader(const std::vector<char>& data) : data(data) {}
+
+    // returns false if there aren't n more values
+    template <typename T>
+    bool read(T* values, std::size_t n) {
+        if (pos + n * sizeof(T) > data.size()) {
+            return false;
+        }
+        std::memcpy(values, data.data() + pos, n * sizeof(T));
+        pos += n * sizeof(T);
+        return true;
+    }
+
+    // skips n values of type T without reading them
+    template <typename T>
+    bool skip(std::size_t n) {
+        if (pos + n * sizeof(T) > data.size()) {
+            return false;
+        }
+        pos += n * sizeof(T);
+        return true;
+    }
+
+    bool done() const { return pos == data.size(); }
+
+private:
+    const std::vector<char>& data;
+    std::size_t pos = 0;
+};
+
+// the economy's agents, indexed by id
+std::vector<Agent*> get_agents_by_id(
+    const std::vector<std::shared_ptr<Person>>& persons,
+    const std::vector<std::shared_ptr<Firm>>& firms
+) {
+    std::vector<Agent*> agents(persons.size() + firms.size());
+    for (const auto& person : persons) {
+        agents[person->get_id()] = person.get();
+    }
+    for (const auto& firm : firms) {
+        agents[firm->get_id()] = firm.get();
+    }
+    return agents;
+}
+
+} // namespace
+
+
+EconomySnapshot::EconomySnapshot(const Economy& economy) {
+    // pending batched orders would be lost
+    assert(economy.batchClearing.get_numPending() == 0);
+    assert(economy.laborMatching.get_numPending() == 0);
+    std::vector<Agent*> agents = get_agents_by_id(economy.persons, economy.firms);
+    unsigned int numAgents = agents.size();
+    unsigned int numGoods = economy.numGoods;
+
+    std::vector<Eigen::ArrayXd> params(numAgents);
+    std::vector<std::uint64_t> paramsEnd(numAgents);
+    std::uint64_t numParams = 0;
+    for (unsigned int i = 0; i < numAgents; i++) {
+        params[i] = agents[i]->get_params();
+        numParams += params[i].size();
+        paramsEnd[i] = numParams;
+    }
+
+    // offers are saved in key order, i.e. the order each agent posted them in, rather than slot order,
+    // so that restore rebuilds every agent's list of offers (which offers are trimmed in) as it was
+    std::vector<const Offer*> availOffers;
+    economy.market.for_each(
+        [&](OfferHandle, const Offer& offer) {
+            if (offer.is_available()) {
+                availOffers.push_back(&offer);
+            }
+        }
+    );
+    std::sort(
+        availOffers.begin(), availOffers.end(),
+        [](const Offer* a, const Offer* b) { return a->key < b->key; }
+    );
+    std::vector<OfferRecord> offers;
+    std::vector<double> quantities;
+    for (const Offer* offer : availOffers) {
+        offers.push_back(OfferRecord{offer->offerer->get_id(), offer->amountLeft, offer->amountTaken, 0, offer->key, offer->price});
+        quantities.insert(quantities.end(), offer->quantities.data(), offer->quantities.data() + numGoods);
+    }
+    std::vector<const JobOffer*> availJobOffers;
+    economy.jobMarket.for_each(
+        [&](JobOfferHandle, const JobOffer& jobOffer) {
+            if (jobOffer.is_available()) {
+                availJobOffers.push_back(&jobOffer);
+            }
+        }
+    );
+    std::sort(
+        availJobOffers.begin(), availJobOffers.end(),
+        [](const JobOffer* a, const JobOffer* b) { return a->key < b->key; }
+    );
+    std::vector<JobOfferRecord> jobOffers;
+    for (const JobOffer* jobOffer : availJobOffers) {
+        jobOffers.push_back(JobOfferRecord{
+            jobOffer->offerer->get_id(), jobOffer->amountLeft, jobOffer->amountTaken, 0,
+            jobOffer->key, jobOffer->labor, jobOffer->wage
+        });
+    }
+
+    Header header;
+    std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.version = VERSION;
+    header.numGoods = numGoods;
+    header.numAgents = numAgents;
+    header.time = economy.time;
+    header.seed = economy.seed;
+    header.numOffers = offers.size();
+    header.numJobOffers = jobOffers.size();
+    header.numParams = numParams;
+
+    data.reserve(
+        sizeof(Header) + sizeof(util::Philox)
+        + numAgents * (sizeof(double) * (2 + numGoods) + 2 * sizeof(std::uint32_t) + 2 * sizeof(std::uint64_t) + sizeof(util::Philox))
+        + numParams * sizeof(double) + numAgents * sizeof(std::uint32_t)
+        + offers.size() * (sizeof(OfferRecord) + numGoods * sizeof(double))
+        + jobOffers.size() * sizeof(JobOfferRecord)
+    );
+    write(data, &header, 1);
+    write(data, &economy.rng, 1);
+    // columns are gathered one at a time so that each is contiguous in the file
+    std::vector<double> column(numAgents);
+    for (unsigned int i = 0; i < numAgents; i++) {
+        column[i] = agents[i]->money;
+    }
+    write(data, column.data(), numAgents);
+    for (unsigned int i = 0; i < numAgents; i++) {
+        column[i] = agents[i]->labor;
+    }
+    write(data, column.data(), numAgents);
+    for (unsigned int i = 0; i < numAgents; i++) {
+        write(data, agents[i]->inventory.data(), numGoods);
+    }
+    std::vector<std::uint32_t> counters(numAgents);
+    for (unsigned int i = 0; i < numAgents; i++) {
+        counters[i] = agents[i]->time;
+    }
+    write(data, counters.data(), numAgents);
+    for (unsigned int i = 0; i < numAgents; i++) {
+        counters[i] = agents[i]->numOffersPosted;
+    }
+    write(data, counters.data(), numAgents);
+    std::vector<std::uint64_t> typeHashes(numAgents);
+    for (unsigned int i = 0; i < numAgents; i++) {
+        typeHashes[i] = hash_typename(agents[i]->get_typename());
+    }
+    write(data, typeHashes.data(), numAgents);
+    for (unsigned int i = 0; i < numAgents; i++) {
+        write(data, &agents[i]->rng, 1);
+    }
+    write(data, paramsEnd.data(), numAgents);
+    for (unsigned int i = 0; i < numAgents; i++) {
+        write(data, params[i].data(), params[i].size());
+    }
+    // persons' ids in step order, then firms'
+    std::vector<std::uint32_t> order;
+    for (const auto& person : economy.persons) {
+        order.push_back(person->get_id());
+    }
+    for (const auto& firm : economy.firms) {
+        order.push_back(firm->get_id());
+    }
+    write(data, order.data(), numAgents);
+    write(data, offers.data(), offers.size());
+    write(data, quantities.data(), quantities.size());
+    write(data, jobOffers.data(), jobOffers.size());
+}
+
+
+bool EconomySnapshot::restore(Economy& economy) const {
+    const Header* header = get_header();
+    std::vector<Agent*> agents = get_agents_by_id(economy.persons, economy.firms);
+    if (header == nullptr || header->numGoods != economy.numGoods || header->numAgents != agents.size()) {
+        return false;
+    }
+    unsigned int numAgents = header->numAgents;
+    unsigned int numGoods = header->numGoods;
+
+    // check that everything matches before touching the economy
+    Reader reader(data);
+    util::Philox rng;
+    std::vector<double> money(numAgents);
+    std::vector<double> labor(numAgents);
+    std::vector<std::uint32_t> times(numAgents);
+    std::vector<std::uint32_t> numOffersPosted(numAgents);
+    std::vector<std::uint64_t> typeHashes(numAgents);
+    std::vector<util::Philox> rngs(numAgents);
+    std::vector<std::uint64_t> paramsEnd(numAgents);
+    bool ok = (
+        reader.skip<Header>(1)
+        && reader.read(&rng, 1)
+        && reader.read(money.data(), numAgents)
+        && reader.read(labor.data(), numAgents)
+    );
+    Eigen::Array<double, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor> inventories(numAgents, numGoods);
+    ok = ok && (
+        reader.read(inventories.data(), inventories.size())
+        && reader.read(times.data(), numAgents)
+        && reader.read(numOffersPosted.data(), numAgents)
+        && reader.read(typeHashes.data(), numAgents)
+        && reader.read(rngs.data(), numAgents)
+        && reader.read(paramsEnd.data(), numAgents)
+    );
+    if (!ok) {
+        return false;
+    }
+    Eigen::ArrayXd params(header->numParams);
+    std::vector<std::uint32_t> order(numAgents);
+    std::vector<OfferRecord> offers(header->numOffers);
+    Eigen::Array<double, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor> quantities(header->numOffers, numGoods);
+    std::vector<JobOfferRecord> jobOffers(header->numJobOffers);
+    ok = (
+        reader.read(params.data(), params.size())
+        && reader.read(order.data(), numAgents)
+        && reader.read(offers.data(), offers.size())
+        && reader.read(quantities.data(), quantities.size())
+        && reader.read(jobOffers.data(), jobOffers.size())
+        && reader.done()
+    );
+    if (!ok) {
+        return false;
+    }
+    for (unsigned int i = 0; i < numAgents; i++) {
+        std::uint64_t paramsBegin = (i == 0) ? 0 : paramsEnd[i-1];
+        if (
+            typeHashes[i] != hash_typename(agents[i]->get_typename())
+            || paramsEnd[i] < paramsBegin
+            || paramsEnd[i] - paramsBegin != std::uint64_t(agents[i]->get_params().size())
+        ) {
+            return false;
+        }
+    }
+    std::vector<Person*> personsById(numAgents, nullptr);
+    for (const auto& person : economy.persons) {
+        personsById[person->get_id()] = person.get();
+    }
+    std::vector<Firm*> firmsById(numAgents, nullptr);
+    for (const auto& firm : economy.firms) {
+        firmsById[firm->get_id()] = firm.get();
+    }
+    // the order must list each person once, then each firm once
+    unsigned int numPersons = economy.persons.size();
+    std::vector<bool> listed(numAgents, false);
+    for (unsigned int i = 0; i < numAgents; i++) {
+        if (
+            order[i] >= numAgents || listed[order[i]]
+            || (i < numPersons ? personsById[order[i]] == nullptr : firmsById[order[i]] == nullptr)
+        ) {
+            return false;
+        }
+        listed[order[i]] = true;
+    }
+    for (const auto& offer : offers) {
+        if (offer.offerer >= numAgents) {
+            return false;
+        }
+    }
+    for (const auto& jobOffer : jobOffers) {
+        if (jobOffer.offerer >= numAgents || firmsById[jobOffer.offerer] == nullptr) {
+            return false;
+        }
+    }
+
+    economy.time = header->time;
+    economy.seed = header->seed;
+    economy.rng = rng;
+    std::vector<std::shared_ptr<Person>> persons(numAgents);
+    for (const auto& person : economy.persons) {
+        persons[person->get_id()] = person;
+    }
+    std::vector<std::shared_ptr<Firm>> firms(numAgents);
+    for (const auto& firm : economy.firms) {
+        firms[firm->get_id()] = firm;
+    }
+    for (unsigned int i = 0; i < numPersons; i++) {
+        economy.persons[i] = persons[order[i]];
+    }
+    for (unsigned int i = numPersons; i < numAgents; i++) {
+        economy.firms[i - numPersons] = firms[order[i]];
+    }
+    for (unsigned int i = 0; i < numAgents; i++) {
+        Agent* agent = agents[i];
+        std::lock_guard<std::mutex> lock(agent->myMutex);
+        agent->money = money[i];
+        agent->labor = labor[i];
+        agent->inventory = inventories.row(i).transpose();
+        agent->time = times[i];
+        agent->numOffersPosted = numOffersPosted[i];
+        agent->rng = rngs[i];
+        std::uint64_t paramsBegin = (i == 0) ? 0 : paramsEnd[i-1];
+        agent->set_params(params.segment(paramsBegin, paramsEnd[i] - paramsBegin));
+        agent->myOffers.clear();
+        agent->committedInventory.setZero();
+        agent->numRetiredOffers = 0;
+    }
+    for (const auto& firm : economy.firms) {
+        firm->myJobOffers.clear();
+        firm->numRetiredJobOffers = 0;
+    }
+    economy.recount_caughtUp();
+
+    // the order book is flushed after the market is cleared, so that it drops every listing
+    economy.market.erase_if([](const Offer&) { return true; });
+    economy.jobMarket.erase_if([](const JobOffer&) { return true; });
+    for (auto& orderBook : economy.orderBooks) {
+        orderBook->flush();
+    }
+    // the market is empty now; the offers added back below count toward depth as they're posted
+    economy.recount_marketDepth();
+    for (unsigned int j = 0; j < offers.size(); j++) {
+        const OfferRecord& record = offers[j];
+        Agent* offerer = agents[record.offerer];
+        Eigen::ArrayXd q = quantities.row(j).transpose();
+        OfferHandle handle = economy.add_offer(offerer, record.amountLeft, q, record.price, record.key);
+        economy.market.get(handle)->amountTaken = record.amountTaken;
+        offerer->myOffers.push_back(handle);
+        offerer->committedInventory += q * record.amountLeft;
+    }
+    for (const auto& record : jobOffers) {
+        Firm* offerer = firmsById[record.offerer];
+        JobOfferHandle handle = economy.add_jobOffer(offerer, record.amountLeft, record.labor, record.wage, record.key);
+        economy.jobMarket.get(handle)->amountTaken = record.amountTaken;
+        offerer->myJobOffers.push_back(handle);
+    }
+    return true;
+}
+
+
+bool EconomySnapshot::save(const std::string& path) const {
+    if (data.empty()) {
+        return false;
+    }
+    int fd = open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        return false;
+    }
+    if (ftruncate(fd, data.size()) != 0) {
+        close(fd);
+        return false;
+    }
+    void* map = mmap(nullptr, data.size(), PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);  // the mapping keeps the file open
+    if (map == MAP_FAILED) {
+        return false;
+    }
+    std::memcpy(map, data.data(), data.size());
+    return munmap(map, data.size()) == 0;
+}
+
+bool EconomySnapshot::load(const std::string& path) {
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+    struct stat info;
+    if (fstat(fd, &info) != 0 || info.st_size < (off_t)sizeof(Header)) {
+        close(fd);
+        return false;
+    }
+    std::size_t size = info.st_size;
+    void* map = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        return false;
+    }
+    const char* bytes = static_cast<const char*>(map);
+    Header header;
+    std::memcpy(&header, bytes, sizeof(Header));
+    bool ok = (std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) == 0 && header.version == VERSION);
+    if (ok) {
+        data.assign(bytes, bytes + size);
+    }
+    munmap(map, size);
+    return ok;
+}
+
+
+const EconomySnapshot::Header* EconomySnapshot::get_header() const {
+    if (data.size() < sizeof(Header)) {
+        return nullptr;
+    }
+    // the header is at the start of the vector's allocation, which is suitably aligned for it
+    return reinterpret_cast<const Header*>(data.data());
+}
+
+bool EconomySnapshot::empty() const { return data.empty(); }
+
+std::size_t EconomySnapshot::get_size() const { return data.size(); }
+
+unsigned int EconomySnapshot::get_time() const {
+    const Header* header = get_header();
+    return (header != nullptr) ? header->time : 0;
+}
+
+unsigned int EconomySnapshot::get_numAgents() const {
+    const Header* header = get_header();
+    return (header != nullptr) ? header->numAgents : 0;
+}
@@ -0,0 +1,62 @@
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "base.h"
+
+
+class EconomySnapshot {
+    /**
+     * A compact binary copy of an Economy's state, taken between time steps.
+     *
+     * Covers the economy's time, seed & setup stream, the order its agents step in (which the next shuffle starts from),
+     * every agent's time, money, labor, inventory, random stream & parameters (see Agent::get_params),
+     * and the offers open on both markets.
+     * It doesn't cover anything that isn't state, like the agents' classes or decision makers,
+     * or the economy's settings (thread pool, lock-free or batched mode).
+     * A snapshot can therefore only be restored into an economy with the same goods
+     * and the same kinds of agents in the same order, e.g. one set up by the same Scenario (see Scenario::fork).
+     *
+     * The format is a header followed by columns: money, labor, inventories (agents x goods, row-major),
+     * then per-agent counters, random streams & parameters, then the step order, then the offers. Numbers are stored in native byte order.
+     * Files are written & read through memory maps, so saving and loading are single bulk copies.
+     */
+public:
+    EconomySnapshot() {}
+    // economy should be between time steps
+    explicit EconomySnapshot(const Economy& economy);
+
+    // overwrites economy's state with the snapshot's; any offers already on its markets are removed
+    // returns false without changing anything if economy doesn't have the same goods & kinds of agents
+    bool restore(Economy& economy) const;
+
+    // return false if the file couldn't be written or read, or (for load) isn't a snapshot
+    bool save(const std::string& path) const;
+    bool load(const std::string& path);
+
+    bool empty() const;
+    std::size_t get_size() const;  // in bytes
+    unsigned int get_time() const;
+    unsigned int get_numAgents() const;
+
+private:
+    struct Header {
+        char magic[8];
+        std::uint32_t version;
+        std::uint32_t numGoods;
+        std::uint32_t numAgents;
+        std::uint32_t time;
+        std::uint64_t seed;
+        std::uint32_t numOffers;
+        std::uint32_t numJobOffers;
+        std::uint64_t numParams;  // total over all agents
+    };
+
+    const Header* get_header() const;
+
+    std::vector<char> data;
+};
+
+#endif
@@ -0,0 +1,141 @@
+#include <assert.h>
+#include <algorithm>
+#include <iostream>
+#include "threadPool.h"
+#include "util.h"
+
+
+ThreadPool::ThreadPool(
+    unsigned int numThreads
+) : numThreads((numThreads > 0) ? numThreads : 1), nextIdx(0) {
+    jobBusySeconds.resize(this->numThreads);
+    stats.resize(this->numThreads);
+    // thread 0 is the caller of run, so only need to spawn numThreads - 1 workers
+    workers.reserve(this->numThreads - 1);
+    for (unsigned int i = 1; i < this->numThreads; i++) {
+        workers.push_back(std::thread(&ThreadPool::work, this, i));
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wakeCondition.notify_all();
+    for (auto& worker : workers) {
+        worker.join();
+    }
+}
+
+unsigned int ThreadPool::get_numThreads() const { return numThreads; }
+
+
+double ThreadPool::run_chunks(const Task& task, unsigned int threadIdx) {
+    double busySeconds = 0.0;
+    unsigned int numChunks = 0;
+    unsigned int startIdx = nextIdx.load();
+    while (true) {
+        if (startIdx >= numTasks) {
+            break;
+        }
+        // take a share of what's left, so chunks start large and get smaller toward the end
+        unsigned int chunkSize = std::max(1u, (numTasks - startIdx) / (2 * numThreads));
+        if (!nextIdx.compare_exchange_weak(startIdx, startIdx + chunkSize)) {
+            // startIdx has been updated to the current value; try again
+            continue;
+        }
+        auto chunkStart = Clock::now();
+        task(startIdx, startIdx + chunkSize);
+        busySeconds += std::chrono::duration<double>(Clock::now() - chunkStart).count();
+        numChunks++;
+        startIdx = nextIdx.load();
+    }
+    stats[threadIdx].numChunks += numChunks;
+    return busySeconds;
+}
+
+
+void ThreadPool::run(unsigned int numTasks, const Task& task) {
+    std::lock_guard<std::mutex> runLock(runMutex);
+    if (numTasks == 0) {
+        return;
+    }
+    auto jobStart = Clock::now();
+    this->numTasks = numTasks;
+    nextIdx.store(0);
+    if (!workers.empty()) {
+        std::lock_guard<std::mutex> lock(mutex);
+        currentTask = &task;
+        numPending = workers.size();
+        generation++;
+    }
+    wakeCondition.notify_all();
+    // the calling thread works alongside the workers
+    jobBusySeconds[0] = run_chunks(task, 0);
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        doneCondition.wait(lock, [this] { return numPending == 0; });
+        currentTask = nullptr;
+    }
+    double jobSeconds = std::chrono::duration<double>(Clock::now() - jobStart).count();
+    for (unsigned int i = 0; i < numThreads; i++) {
+        stats[i].busySeconds += jobBusySeconds[i];
+        stats[i].idleSeconds += std::max(0.0, jobSeconds - jobBusySeconds[i]);
+    }
+}
+
+
+void ThreadPool::work(unsigned int workerIdx) {
+    unsigned int lastGeneration = 0;
+    while (true) {
+        const Task* task;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            wakeCondition.wait(lock, [this, lastGeneration] {
+                return stopping || generation != lastGeneration;
+            });
+            if (stopping) {
+                return;
+            }
+            lastGeneration = generation;
+            task = currentTask;
+        }
+        double busySeconds = run_chunks(*task, workerIdx);
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            jobBusySeconds[workerIdx] = busySeconds;
+            assert(numPending > 0);
+            if (--numPending == 0) {
+                doneCondition.notify_one();
+            }
+        }
+    }
+}
+
+
+std::vector<WorkerStats> ThreadPool::get_stats() {
+    std::lock_guard<std::mutex> runLock(runMutex);
+    return stats;
+}
+
+void ThreadPool::reset_stats() {
+    std::lock_guard<std::mutex> runLock(runMutex);
+    for (auto& s : stats) {
+        s = WorkerStats();
+    }
+}
+
+void ThreadPool::print_stats(unsigned int priority) {
+    if (constants::verbose < priority) {
+        return;
+    }
+    auto stats_ = get_stats();
+    for (unsigned int i = 0; i < stats_.size(); i++) {
+        double total = stats_[i].busySeconds + stats_[i].idleSeconds;
+        double busyPct = (total > 0.0) ? 100.0 * stats_[i].busySeconds / total : 0.0;
+        std::cout << "Thread " << i << ": busy " << stats_[i].busySeconds << "s, idle "
+            << stats_[i].idleSeconds << "s (" << busyPct << "% busy, "
+            << stats_[i].numChunks << " chunks)\n";
+    }
+}
@@ -0,0 +1,77 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+
+struct WorkerStats {
+    // cumulative time a thread spent running tasks vs. waiting inside ThreadPool::run for the other threads
+    double busySeconds = 0.0;
+    double idleSeconds = 0.0;
+    unsigned int numChunks = 0;  // number of chunks of tasks this thread has claimed
+};
+
+
+class ThreadPool {
+    // A set of long-lived worker threads that park between jobs.
+    // The economy uses this to run agents' time steps without spawning & joining fresh threads every phase
+    // The calling thread always does a share of the work, so a pool of size 1 has no workers and runs serially
+    // Tasks are handed out dynamically: each thread repeatedly claims the next chunk of unclaimed indices,
+    // with chunks shrinking as the job nears completion (guided self-scheduling),
+    // so that a few expensive tasks don't leave the other threads idle at the join
+public:
+    // takes a start index and an end index; should operate on [startIdx, endIdx)
+    using Task = std::function<void(unsigned int, unsigned int)>;
+
+    ThreadPool(unsigned int numThreads);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    unsigned int get_numThreads() const;
+
+    // calls task on chunks that together cover [0, numTasks) exactly once
+    // blocks until every chunk is done
+    // calls from different threads are serialized; a task must not call run on the same pool
+    void run(unsigned int numTasks, const Task& task);
+
+    // stats are indexed by thread; index 0 is whichever thread calls run
+    std::vector<WorkerStats> get_stats();
+    void reset_stats();
+    // prints busy/idle time for each thread if constants::verbose >= priority
+    void print_stats(unsigned int priority);
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    void work(unsigned int workerIdx);
+    // claims & runs chunks until none are left, returns seconds spent in task
+    double run_chunks(const Task& task, unsigned int threadIdx);
+
+    unsigned int numThreads;
+    std::vector<std::thread> workers;
+
+    std::mutex runMutex;  // held for the duration of a call to run
+    std::mutex mutex;  // protects everything below except nextIdx
+    std::condition_variable wakeCondition;  // workers park on this between jobs
+    std::condition_variable doneCondition;  // run waits on this for workers to finish
+
+    const Task* currentTask = nullptr;
+    unsigned int numTasks = 0;
+    std::atomic<unsigned int> nextIdx;  // first index not yet claimed by any thread
+    unsigned int generation = 0;  // incremented every time a new job is posted
+    unsigned int numPending = 0;  // workers that haven't finished the current job
+    bool stopping = false;
+
+    std::vector<double> jobBusySeconds;  // busy time per thread for the current job
+    std::vector<WorkerStats> stats;
+};
+
+#endif
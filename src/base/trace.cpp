@@ -0,0 +1,193 @@
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include "trace.h"
+
+
+namespace trace {
+
+namespace {
+
+const char MAGIC[8] = {'f', 'a', 's', 't', 'A', 'C', 'E', 't'};
+const std::uint32_t VERSION = 1;
+
+const char* NAMES[] = {
+    "search for jobs",
+    "buy goods",
+    "consume goods",
+    "check job offers",
+    "produce",
+    "sell goods",
+    "search for laborers",
+    "respond to offer",
+    "reserve offer",
+    "review offer response",
+    "accept offer response",
+    "respond to job offer",
+    "review job offer response",
+    "accept job offer response",
+    "offer unavailable",
+    "can't afford",
+    "missing training data",
+};
+static_assert(sizeof(NAMES) / sizeof(NAMES[0]) == static_cast<std::size_t>(Event::NumEvents), "every event needs a name");
+
+struct Header {
+    char magic[8];
+    std::uint32_t version;
+    std::uint32_t recordSize;
+    std::uint64_t numRecords;
+};
+
+class RingBuffer {
+    // written by one thread only; numWritten is atomic so that readers on other threads see whole records
+public:
+    RingBuffer(unsigned int size, std::uint16_t thread) : records(size), mask(size - 1), thread(thread) {}
+
+    void push(const Record& record) {
+        std::uint64_t n = numWritten.load(std::memory_order_relaxed);
+        records[n & mask] = record;
+        records[n & mask].thread = thread;
+        numWritten.store(n + 1, std::memory_order_release);
+    }
+
+    void append_to(std::vector<Record>& out) const {
+        std::uint64_t n = numWritten.load(std::memory_order_acquire);
+        std::uint64_t begin = (n > records.size()) ? n - records.size() : 0;
+        for (std::uint64_t i = begin; i < n; i++) {
+            out.push_back(records[i & mask]);
+        }
+    }
+
+    void clear() { numWritten.store(0, std::memory_order_release); }
+
+private:
+    std::vector<Record> records;
+    std::uint64_t mask;
+    std::uint16_t thread;
+    std::atomic<std::uint64_t> numWritten{0};
+};
+
+using Clock = std::chrono::steady_clock;
+
+// buffers are owned here rather than by their threads, so that events outlive the threads that recorded them
+std::mutex buffersMutex;
+std::vector<std::unique_ptr<RingBuffer>> buffers;
+unsigned int bufferSize = 1 << 16;
+const Clock::time_point startTime = Clock::now();
+
+thread_local RingBuffer* localBuffer = nullptr;
+
+RingBuffer* get_localBuffer() {
+    if (localBuffer == nullptr) {
+        std::lock_guard<std::mutex> lock(buffersMutex);
+        buffers.push_back(std::make_unique<RingBuffer>(bufferSize, buffers.size()));
+        localBuffer = buffers.back().get();
+    }
+    return localBuffer;
+}
+
+} // namespace
+
+
+std::atomic<unsigned int> currentLevel(0);
+
+const char* get_name(Event event) {
+    if (event >= Event::NumEvents) {
+        return "unknown";
+    }
+    return NAMES[static_cast<std::size_t>(event)];
+}
+
+void set_level(unsigned int level) {
+    currentLevel.store(level, std::memory_order_relaxed);
+}
+
+unsigned int get_level() {
+    return currentLevel.load(std::memory_order_relaxed);
+}
+
+void set_bufferSize(unsigned int size) {
+    unsigned int rounded = 1;
+    while (rounded < size) {
+        rounded <<= 1;
+    }
+    std::lock_guard<std::mutex> lock(buffersMutex);
+    bufferSize = rounded;
+}
+
+void write(
+    Event event,
+    std::uint32_t agent,
+    std::uint32_t time,
+    std::uint32_t subject,
+    double value
+) {
+    Record record;
+    record.nanoseconds = std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - startTime).count();
+    record.agent = agent;
+    record.time = time;
+    record.subject = subject;
+    record.event = static_cast<std::uint16_t>(event);
+    record.value = value;
+    get_localBuffer()->push(record);
+}
+
+std::vector<Record> collect() {
+    std::vector<Record> records;
+    {
+        std::lock_guard<std::mutex> lock(buffersMutex);
+        for (const auto& buffer : buffers) {
+            buffer->append_to(records);
+        }
+    }
+    std::stable_sort(
+        records.begin(), records.end(),
+        [](const Record& a, const Record& b) { return a.nanoseconds < b.nanoseconds; }
+    );
+    return records;
+}
+
+void clear() {
+    std::lock_guard<std::mutex> lock(buffersMutex);
+    for (const auto& buffer : buffers) {
+        buffer->clear();
+    }
+}
+
+bool dump(const std::string& path) {
+    std::vector<Record> records = collect();
+    Header header;
+    std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.version = VERSION;
+    header.recordSize = sizeof(Record);
+    header.numRecords = records.size();
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    file.write(reinterpret_cast<const char*>(records.data()), records.size() * sizeof(Record));
+    return file.good();
+}
+
+bool read(const std::string& path, std::vector<Record>& records) {
+    std::ifstream file(path, std::ios::binary);
+    Header header;
+    if (!file.read(reinterpret_cast<char*>(&header), sizeof(header))) {
+        return false;
+    }
+    if (
+        std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0
+        || header.version != VERSION
+        || header.recordSize != sizeof(Record)
+    ) {
+        return false;
+    }
+    records.resize(header.numRecords);
+    return static_cast<bool>(
+        file.read(reinterpret_cast<char*>(records.data()), records.size() * sizeof(Record))
+    );
+}
+
+} // namespace trace
@@ -0,0 +1,105 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+
+namespace trace {
+    /**
+     * Structured tracing of what agents are doing, for debugging & profiling simulations.
+     *
+     * Events are fixed-size binary records rather than strings. Each thread writes its events into
+     * its own ring buffer without locking; once a buffer is full, its oldest events are overwritten.
+     * Whether an event is recorded depends on a runtime level, checked inline before anything else is done,
+     * so disabled trace points cost a load & a comparison.
+     * Buffers are read with collect or dump, and dumped files are decoded with the readTrace tool (src/tools).
+     * Reading, clearing & changing the buffer size must only be done while no thread is recording,
+     * e.g. between time steps.
+     */
+
+    enum class Event : std::uint16_t {
+        SearchForJobs,
+        BuyGoods,
+        ConsumeGoods,
+        CheckJobOffers,
+        Produce,
+        SellGoods,
+        SearchForLaborers,
+        RespondToOffer,  // subject is the offer's index on the market, value its price
+        ReserveOffer,
+        ReviewOfferResponse,
+        AcceptOfferResponse,
+        RespondToJobOffer,  // subject is the job offer's index on the job market, value its wage
+        ReviewJobOfferResponse,
+        AcceptJobOfferResponse,
+        OfferUnavailable,
+        CannotAfford,
+        MissingTrainingData,  // subject is the step the agent has no log proba, reward or value for
+        NumEvents
+    };
+
+    // name used when printing event
+    const char* get_name(Event event);
+
+    struct Record {
+        std::uint64_t nanoseconds;  // since the first event was recorded
+        std::uint32_t agent;  // agent id
+        std::uint32_t time;  // the agent's time step
+        std::uint32_t subject;  // e.g. an offer index; see Event
+        std::uint16_t event;
+        std::uint16_t thread;  // threads are numbered in the order they first record an event
+        double value;
+    };
+    static_assert(sizeof(Record) == 32, "trace records should be 32 bytes");
+
+    // events at level <= the current level are recorded; 0 disables tracing, which is the default
+    // agents' events are at level 3, matching the old status printing
+    void set_level(unsigned int level);
+    unsigned int get_level();
+
+    // number of events each thread's ring buffer keeps; rounded up to a power of 2
+    // only applies to buffers created after the call
+    void set_bufferSize(unsigned int size);
+
+    // out of line part of record
+    void write(
+        Event event,
+        std::uint32_t agent,
+        std::uint32_t time,
+        std::uint32_t subject,
+        double value
+    );
+
+    extern std::atomic<unsigned int> currentLevel;
+
+    inline bool enabled(unsigned int level) {
+        return level <= currentLevel.load(std::memory_order_relaxed);
+    }
+
+    inline void record(
+        unsigned int level,
+        Event event,
+        std::uint32_t agent,
+        std::uint32_t time,
+        std::uint32_t subject = 0,
+        double value = 0.0
+    ) {
+        if (enabled(level)) {
+            write(event, agent, time, subject, value);
+        }
+    }
+
+    // events still held by the buffers, sorted by timestamp
+    std::vector<Record> collect();
+    // drops all buffered events
+    void clear();
+
+    // return false if the file couldn't be written or read, or (for read) isn't a trace
+    bool dump(const std::string& path);
+    bool read(const std::string& path, std::vector<Record>& records);
+}
+
+#endif
@@ -1,24 +1,72 @@
 #include <cmath>
+#include <limits>
 #include "util.h"
 
 namespace util {
 
+std::uint64_t get_seed() {
+    return std::chrono::steady_clock::now().time_since_epoch().count();
+}
+
 std::default_random_engine get_rng() {
-    unsigned int seed = std::chrono::steady_clock::now().time_since_epoch().count();
-    return std::default_random_engine(seed);
+    return std::default_random_engine(get_seed());
 }
 
-std::vector<unsigned int> get_indices_for_multithreading(unsigned int numAgents) {
-    unsigned int agentsPerThread = numAgents / constants::numThreads;
-    unsigned int extras = numAgents % constants::numThreads;
-    std::vector<unsigned int> indices(constants::numThreads + 1);
+std::vector<unsigned int> get_indices_for_multithreading(unsigned int numAgents, unsigned int numThreads) {
+    unsigned int agentsPerThread = numAgents / numThreads;
+    unsigned int extras = numAgents % numThreads;
+    std::vector<unsigned int> indices(numThreads + 1);
     indices[0] = 0;
-    for (unsigned int i = 1; i <= constants::numThreads; i++) {
+    for (unsigned int i = 1; i <= numThreads; i++) {
         indices[i] = indices[i-1] + agentsPerThread + (i <= extras);
     }
     return indices;
 }
 
+std::vector<unsigned int> get_indices_for_multithreading(unsigned int numAgents) {
+    return get_indices_for_multithreading(numAgents, constants::numThreads);
+}
+
+unsigned int get_affordable(double budget, double price, unsigned int amount) {
+    if (price <= 0) {
+        return amount;
+    }
+    if (!(budget >= price)) {
+        return 0;
+    }
+    if (budget / price < amount) {
+        amount = static_cast<unsigned int>(std::floor(budget / price));
+    }
+    // the division can round up past what budget covers
+    while (amount > 0 && price * amount > budget) {
+        amount--;
+    }
+    return amount;
+}
+
+void trim_to_inventory(
+    Eigen::Ref<Eigen::ArrayXd> inventory,
+    const Eigen::Ref<const Eigen::ArrayXXd>& quantities,
+    unsigned int* amounts
+) {
+    for (unsigned int j = 0; j < quantities.cols(); j++) {
+        amounts[j] = get_coverable(inventory, quantities.col(j), amounts[j]);
+        inventory -= quantities.col(j) * amounts[j];
+    }
+}
+
+void trim_to_inventory(
+    Eigen::Ref<Eigen::ArrayXXd> inventories,
+    const Eigen::Ref<const Eigen::ArrayXXd>& quantities,
+    unsigned int* amounts,
+    const std::vector<unsigned int>& offerStart
+) {
+    for (unsigned int i = 0; i + 1 < offerStart.size(); i++) {
+        unsigned int begin = offerStart[i];
+        trim_to_inventory(inventories.col(i), quantities.middleCols(begin, offerStart[i+1] - begin), amounts + begin);
+    }
+}
+
 void pprint(unsigned int priority, const std::string& message) {
     if (constants::verbose >= priority) {
         std::cout << message << std::endl;
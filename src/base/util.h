@@ -6,33 +6,75 @@
 #include <vector>
 #include <random>
 #include <algorithm>
+#include <atomic>
 #include <chrono>
+#include <cmath>
+#include <cstdint>
 #include <iostream>
+#include <limits>
 #include <string>
+#include <Eigen/Dense>
 #include "constants.h"
+#include "slotMap.h"
 
 class Agent;
 
 namespace util {
 
+// a seed taken from the clock
+std::uint64_t get_seed();
 std::default_random_engine get_rng();
 
+// slot order depends on how threads interleaved while posting, so put offers in key order before shuffling
+template <typename T, typename RNG>
+void shuffle_by_key(std::vector<Handle<T>>& offers, const SlotMap<T>& market, RNG& rng) {
+    std::sort(
+        std::begin(offers), std::end(offers),
+        [&market](Handle<T> a, Handle<T> b) { return market.get(a)->key < market.get(b)->key; }
+    );
+    std::shuffle(std::begin(offers), std::end(offers), rng);
+}
+
 // helper function used for filtering offers by availability
-template <typename T>
-std::vector<std::weak_ptr<const T>> filter_available(
+// returns handles to the offers in market that are available and not posted by requester, shuffled
+template <typename T, typename RNG>
+std::vector<Handle<T>> filter_available(
     std::shared_ptr<Agent> requester,
-    const std::vector<std::weak_ptr<const T>>& offers,
-    std::default_random_engine rng
+    const SlotMap<T>& market,
+    RNG& rng
 ) {
-    std::vector<std::weak_ptr<const T>> availOffers;
-    availOffers.reserve(offers.size());
-    for (auto offer_ : offers) {
-        auto offer = offer_.lock();
-        if (offer != nullptr && offer->is_available() && (offer->offerer.lock() != requester)) {
-            availOffers.push_back(offer);
+    std::vector<Handle<T>> availOffers;
+    availOffers.reserve(market.size());
+    market.for_each(
+        [&](Handle<T> handle, const T& offer) {
+            if (offer.is_available() && offer.offerer != requester.get()) {
+                availOffers.push_back(handle);
+            }
         }
-    }
-    std::shuffle(std::begin(availOffers), std::end(availOffers), rng);
+    );
+    shuffle_by_key(availOffers, market, rng);
+    return availOffers;
+}
+
+// same, but only looks at the offers posted in one region (e.g. the requester's, see Economy::set_numRegions)
+template <typename T, typename RNG>
+std::vector<Handle<T>> filter_available(
+    std::shared_ptr<Agent> requester,
+    const SlotMap<T>& market,
+    unsigned int region,
+    RNG& rng
+) {
+    std::vector<Handle<T>> availOffers;
+    availOffers.reserve(market.size_of(region));
+    market.for_each_in(
+        region,
+        [&](Handle<T> handle, const T& offer) {
+            if (offer.is_available() && offer.offerer != requester.get()) {
+                availOffers.push_back(handle);
+            }
+        }
+    );
+    shuffle_by_key(availOffers, market, rng);
     return availOffers;
 }
 
@@ -46,17 +88,18 @@ std::shared_ptr<T> create(Args&& ... args) {
 }
 
 
-// helper for getting rid of unavailable offers
+// helper for getting rid of handles to offers that are gone or unavailable
 template <typename T>
 void flush(
-    std::vector<std::weak_ptr<T>>& offers
+    std::vector<Handle<T>>& offers,
+    const SlotMap<T>& market
 ) {
     offers.erase(
         std::remove_if(
             offers.begin(),
             offers.end(),
-            [](std::weak_ptr<T> offer_) {
-                auto offer = offer_.lock();
+            [&market](Handle<T> handle) {
+                const T* offer = market.get(handle);
                 return (offer == nullptr || !offer->is_available());
             }
         ),
@@ -64,25 +107,93 @@ void flush(
     );
 }
 
+
+// like flush, but only sweeps once more than constants::maxTombstoneRatio of the offers have been retired
+// numRetired counts retirements since the last sweep; it's decremented by the number swept
 template <typename T>
-void flush(
-    std::vector<std::shared_ptr<T>>& offers
+void flush_if_stale(
+    std::vector<Handle<T>>& offers,
+    const SlotMap<T>& market,
+    std::atomic<unsigned int>& numRetired
 ) {
-    offers.erase(
-        std::remove_if(
-            offers.begin(),
-            offers.end(),
-            [](std::shared_ptr<T> offer) { return !offer->is_available(); }
-        ),
-        offers.end()
-    );
+    unsigned int retired = numRetired.load();
+    if (retired > constants::maxTombstoneRatio * offers.size()) {
+        flush(offers, market);
+        numRetired -= retired;
+    }
 }
 
 
 // helper for dividing up agents to be operated on by multiple threads
+std::vector<unsigned int> get_indices_for_multithreading(unsigned int numAgents, unsigned int numThreads);
+// same as above, with numThreads = constants::numThreads
 std::vector<unsigned int> get_indices_for_multithreading(unsigned int numAgents);
 
 
+// the most units (up to amount) at price that budget can pay for
+unsigned int get_affordable(double budget, double price, unsigned int amount);
+// the most units (up to amount) of an offer of quantities that inventory can cover,
+// i.e. the min over the goods the offer uses of inventory / quantity
+// a template, so that with a fixed number of goods (see goods.h) the loops over goods are unrolled
+template <typename Inventory, typename Quantities>
+unsigned int get_coverable(
+    const Eigen::ArrayBase<Inventory>& inventory,
+    const Eigen::ArrayBase<Quantities>& quantities,
+    unsigned int amount
+) {
+    // goods the offer doesn't use don't limit it, even if there's a shortfall of them
+    double limit = (quantities > 0).select(inventory / quantities, std::numeric_limits<double>::infinity()).minCoeff();
+    if (!(limit > 0)) {
+        return 0;
+    }
+    if (limit < amount) {
+        amount = static_cast<unsigned int>(std::floor(limit));
+    }
+    // the division can round up past what inventory covers, but by less than a unit
+    // again only the goods the offer uses count, so a shortfall (or rounding dust) elsewhere can't stall it
+    if (amount > 0 && (quantities > 0 && quantities * amount > inventory).any()) {
+        amount--;
+    }
+    return amount;
+}
+// trims offers, in order, to what inventory can still cover once the offers before them are filled,
+// and subtracts what they'll take from inventory
+// offers are the columns of quantities; their amounts are updated in place
+void trim_to_inventory(
+    Eigen::Ref<Eigen::ArrayXd> inventory,
+    const Eigen::Ref<const Eigen::ArrayXXd>& quantities,
+    unsigned int* amounts
+);
+// the same for many agents' offers in one pass: agent i's inventory is column i of inventories
+// and its offers are columns [offerStart[i], offerStart[i+1]) of quantities
+void trim_to_inventory(
+    Eigen::Ref<Eigen::ArrayXXd> inventories,
+    const Eigen::Ref<const Eigen::ArrayXXd>& quantities,
+    unsigned int* amounts,
+    const std::vector<unsigned int>& offerStart
+);
+
+
+// behaves like a double& whose target can be changed
+// used for agent state that may live either in the agent itself or in an AgentStateStore
+class ScalarView {
+public:
+    explicit ScalarView(double* target) : target(target) {}
+    ScalarView(const ScalarView&) = delete;
+    ScalarView& operator=(const ScalarView&) = delete;
+
+    operator double&() const { return *target; }
+    ScalarView& operator=(double x) { *target = x; return *this; }
+    ScalarView& operator+=(double x) { *target += x; return *this; }
+    ScalarView& operator-=(double x) { *target -= x; return *this; }
+
+    void rebind(double* newTarget) { target = newTarget; }
+
+private:
+    double* target;
+};
+
+
 template <typename T>
 T make_positive(T x) {
     if (x <= 0) {
@@ -129,45 +240,6 @@ void print(Args&& ... args) {
 }
 
 
-template <typename T>
-void pprint_status(
-    unsigned int priority,
-    T* origin,
-    const std::string& status
-) {
-    if (constants::verbose >= priority) {
-        std::cout << origin
-            << " (" << origin->get_typename() << ") : "
-            << status << '\n';
-    }
-}
-
-template <typename T>
-void pprint_status(
-    unsigned int priority,
-    std::shared_ptr<T> origin,
-    const std::string& status
-) {
-    if (constants::verbose >= priority) {
-        std::cout << origin
-            << " (" << origin->get_typename() << ") : "
-            << status << '\n';
-    }
-}
-
-// print status if verbose >= 2
-template <typename T>
-void print_status(T* origin, const std::string& status) {
-    pprint_status(3, origin, status);
-}
-
-
-template <typename T>
-void print_status(std::shared_ptr<T> origin, const std::string& status) {
-    pprint_status(3, origin, status);
-}
-
-
 void pprint_time_elasped(
     unsigned int priority,
     std::chrono::time_point<std::chrono::system_clock> start_time,
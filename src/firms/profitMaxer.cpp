@@ -42,15 +42,16 @@ std::string ProfitMaxer::get_typename() const {
 }
 
 
-Eigen::ArrayXd ProfitMaxer::f(double labor, const Eigen::ArrayXd& quantities) {
-    Eigen::ArrayXd inputs(prodFunc->numInputs);
+Eigen::ArrayXd ProfitMaxer::f(double labor, const Eigen::Ref<const Eigen::ArrayXd>& quantities) {
+    // labor, then each good
+    GoodsArray<NumGoods, 1> inputs(prodFunc->numInputs);
     inputs << labor, quantities;
     return prodFunc->f(inputs);
 }
 
 double ProfitMaxer::get_revenue(
     double labor,
-    const Eigen::ArrayXd& quantities,
+    const Eigen::Ref<const Eigen::ArrayXd>& quantities,
     const Eigen::ArrayXd& prices
 ) {
     return f(labor, quantities).matrix().dot(prices.matrix());
@@ -64,6 +65,14 @@ std::shared_ptr<const FirmDecisionMaker> ProfitMaxer::get_decisionMaker() const
     return decisionMaker;
 }
 
+Eigen::ArrayXd ProfitMaxer::get_params() const {
+    return prodFunc->get_params();
+}
+
+void ProfitMaxer::set_params(const Eigen::ArrayXd& params) {
+    prodFunc->set_params(params);
+}
+
 
 void ProfitMaxer::produce() {
     std::lock_guard<std::mutex> lock(myMutex);
@@ -76,36 +85,51 @@ void ProfitMaxer::sell_goods() {
     // remove last round's offers from the market before posting new offers
     {
         std::lock_guard<std::mutex> lock(myMutex);
-        for (auto offer : myOffers) {
-            offer->amountLeft = 0;
+        for (auto handle : myOffers) {
+            withdraw_offer(handle);
         }
     }
-    for (auto offer : newOffers) {
+    for (const auto& offer : newOffers) {
         post_offer(offer);
     }
 }
 
 void ProfitMaxer::search_for_laborers() {
     auto newJobOffers = decisionMaker->choose_job_offers();
+    std::vector<bool> kept(newJobOffers.size(), false);
     {
         std::lock_guard<std::mutex> lock(myMutex);
-        // remove last round's offers from the market before posting new offers
-        for (auto offer : myJobOffers) {
-            offer->amountLeft = 0;
+        // last round's offers on the same terms as new ones are topped up in place rather than reposted,
+        // so the job market doesn't churn while a firm's plans stay the same; the rest are withdrawn
+        for (auto handle : myJobOffers) {
+            JobOffer* jobOffer = lookup_jobOffer(handle);
+            if (jobOffer == nullptr || !jobOffer->is_available()) {
+                continue;
+            }
+            bool reused = false;
+            for (unsigned int i = 0; i < newJobOffers.size(); i++) {
+                if (
+                    !kept[i] && newJobOffers[i].amountLeft > 0
+                    && newJobOffers[i].labor == jobOffer->labor && newJobOffers[i].wage == jobOffer->wage
+                ) {
+                    jobOffer->amountLeft = newJobOffers[i].amountLeft.load();
+                    kept[i] = true;
+                    reused = true;
+                    break;
+                }
+            }
+            if (!reused) {
+                withdraw_jobOffer(handle);
+            }
         }
     }
-    for (auto offer : newJobOffers) {
-        post_jobOffer(offer);
+    for (unsigned int i = 0; i < newJobOffers.size(); i++) {
+        if (!kept[i]) {
+            post_jobOffer(newJobOffers[i]);
+        }
     }
 }
 
 void ProfitMaxer::buy_goods() {
-    auto orders = decisionMaker->choose_goods();
-    for (auto order : orders) {
-        for (unsigned int i = 0; i < order.amount; i++) {
-            if (!respond_to_offer(order.offer)) {
-                break;
-            }
-        }
-    }
+    place_orders(decisionMaker->choose_goods());
 }
@@ -11,8 +11,9 @@ class ProfitMaxer;
 class FirmDecisionMaker {
 public:
     virtual Eigen::ArrayXd choose_production_inputs() = 0;
-    virtual std::vector<std::shared_ptr<Offer>> choose_good_offers() = 0;
-    virtual std::vector<std::shared_ptr<JobOffer>> choose_job_offers() = 0;
+    // offers are posted by value; the Economy's markets take copies
+    virtual std::vector<Offer> choose_good_offers() = 0;
+    virtual std::vector<JobOffer> choose_job_offers() = 0;
     virtual std::vector<Order<Offer>> choose_goods() = 0;
     // should leave parent unitialized at first
     // since ProfitMaxer::init will automatically assign decision maker to itself
@@ -36,11 +37,14 @@ public:
         return profitMaxer;
     }
 
-    Eigen::ArrayXd f(double labor, const Eigen::ArrayXd& quantities);
-    double get_revenue(double labor, const Eigen::ArrayXd& quantities, const Eigen::ArrayXd& prices);
+    Eigen::ArrayXd f(double labor, const Eigen::Ref<const Eigen::ArrayXd>& quantities);
+    double get_revenue(double labor, const Eigen::Ref<const Eigen::ArrayXd>& quantities, const Eigen::ArrayXd& prices);
 
     std::shared_ptr<const VecToVec> get_prodFunc() const;
     std::shared_ptr<const FirmDecisionMaker> get_decisionMaker() const;
+    // prodFunc's params
+    virtual Eigen::ArrayXd get_params() const override;
+    virtual void set_params(const Eigen::ArrayXd& params) override;
 
     virtual std::string get_typename() const override;
 
@@ -22,19 +22,36 @@ void VecToScalar::check_no_length_change(const Eigen::ArrayXd& candidate) const
     assert(candidate.size() == numInputs);
 }
 
+Eigen::ArrayXd VecToScalar::get_params() const {
+    return Eigen::ArrayXd(0);
+}
+
+void VecToScalar::set_params(const Eigen::ArrayXd& params) {
+    assert(params.size() == 0);
+}
+
 
 
 Linear::Linear(unsigned int numInputs) : VecToScalar(numInputs), productivities(Eigen::ArrayXd::Constant(numInputs, 1.0)) {}
 Linear::Linear(const Eigen::ArrayXd& productivities) : VecToScalar(productivities.size()), productivities(productivities) {}
 
-double Linear::f(const Eigen::ArrayXd& quantities) const {
+double Linear::f(const Eigen::Ref<const Eigen::ArrayXd>& quantities) const {
     return (productivities * quantities).sum();
 }
 
-double Linear::df(const Eigen::ArrayXd& quantities, unsigned int idx) const {
+double Linear::df(const Eigen::Ref<const Eigen::ArrayXd>& quantities, unsigned int idx) const {
     return productivities(idx);
 }
 
+Eigen::ArrayXd Linear::get_params() const {
+    return productivities;
+}
+
+void Linear::set_params(const Eigen::ArrayXd& params) {
+    check_no_length_change(params);
+    productivities = params;
+}
+
 
 CobbDouglas::CobbDouglas(
     unsigned int numInputs
@@ -42,14 +59,26 @@ CobbDouglas::CobbDouglas(
 
 CobbDouglas::CobbDouglas(double tfp, const Eigen::ArrayXd& elasticities) : VecToScalar(elasticities.size()), tfp(tfp), elasticities(elasticities) {}
 
-double CobbDouglas::f(const Eigen::ArrayXd& quantities) const {
+double CobbDouglas::f(const Eigen::Ref<const Eigen::ArrayXd>& quantities) const {
     return tfp * Eigen::pow(quantities, elasticities).prod();
 }
 
-double CobbDouglas::df(const Eigen::ArrayXd& quantities, unsigned int idx) const {
+double CobbDouglas::df(const Eigen::Ref<const Eigen::ArrayXd>& quantities, unsigned int idx) const {
     return f(quantities) * elasticities(idx) / quantities(idx);
 }
 
+Eigen::ArrayXd CobbDouglas::get_params() const {
+    Eigen::ArrayXd params(numInputs + 1);
+    params << tfp, elasticities;
+    return params;
+}
+
+void CobbDouglas::set_params(const Eigen::ArrayXd& params) {
+    assert(params.size() == numInputs + 1);
+    tfp = params(0);
+    elasticities = params.segment(1, numInputs);
+}
+
 
 CobbDouglasCRS::CobbDouglasCRS(double tfp, const Eigen::ArrayXd& elasticities) : CobbDouglas(tfp, elasticities) {
     this->elasticities /= elasticities.sum();
@@ -64,24 +93,36 @@ StoneGeary::StoneGeary(
 }
 
 
-double StoneGeary::f(const Eigen::ArrayXd& quantities) const {
+double StoneGeary::f(const Eigen::Ref<const Eigen::ArrayXd>& quantities) const {
     return tfp * Eigen::pow(quantities - thresholdParams, elasticities).prod();
 }
 
-double StoneGeary::df(const Eigen::ArrayXd& quantities, unsigned int idx) const {
+double StoneGeary::df(const Eigen::Ref<const Eigen::ArrayXd>& quantities, unsigned int idx) const {
     return f(quantities) * elasticities(idx) / (quantities(idx) - thresholdParams(idx));
 }
 
+Eigen::ArrayXd StoneGeary::get_params() const {
+    Eigen::ArrayXd params(2 * numInputs + 1);
+    params << tfp, elasticities, thresholdParams;
+    return params;
+}
+
+void StoneGeary::set_params(const Eigen::ArrayXd& params) {
+    assert(params.size() == 2 * numInputs + 1);
+    CobbDouglas::set_params(params.head(numInputs + 1));
+    thresholdParams = params.tail(numInputs);
+}
+
 
 
 
 Leontief::Leontief(const Eigen::ArrayXd& productivities) : VecToScalar(productivities.size()), productivities(productivities) {}
 
-double Leontief::f(const Eigen::ArrayXd& quantities) const {
+double Leontief::f(const Eigen::Ref<const Eigen::ArrayXd>& quantities) const {
     return (quantities * productivities).minCoeff();
 }
 
-double Leontief::df(const Eigen::ArrayXd& quantities, unsigned int idx) const {
+double Leontief::df(const Eigen::Ref<const Eigen::ArrayXd>& quantities, unsigned int idx) const {
     const Eigen::ArrayXd& values = quantities * productivities;
     unsigned int minIdx = 0;
     double minVal = min(values, numInputs, &minIdx);
@@ -99,6 +140,15 @@ double Leontief::df(const Eigen::ArrayXd& quantities, unsigned int idx) const {
     }
 }
 
+Eigen::ArrayXd Leontief::get_params() const {
+    return productivities;
+}
+
+void Leontief::set_params(const Eigen::ArrayXd& params) {
+    check_no_length_change(params);
+    productivities = params;
+}
+
 
 
 
@@ -109,20 +159,34 @@ CES::CES(
     shareParams(shareParams / shareParams.sum()),
     substitutionParam(1 / (1-elasticityOfSubstitution)) {}
 
-double CES::get_inner_sum(const Eigen::ArrayXd& quantities) const {
+double CES::get_inner_sum(const Eigen::Ref<const Eigen::ArrayXd>& quantities) const {
     return (shareParams * Eigen::pow(quantities + constants::eps, substitutionParam)).sum();
 }
 
-double CES::f(const Eigen::ArrayXd& quantities) const {
+double CES::f(const Eigen::Ref<const Eigen::ArrayXd>& quantities) const {
     return tfp * pow(get_inner_sum(quantities), 1 / substitutionParam);
 }
 
-double CES::df(const Eigen::ArrayXd& quantities, unsigned int idx) const {
+double CES::df(const Eigen::Ref<const Eigen::ArrayXd>& quantities, unsigned int idx) const {
     double innerSum = get_inner_sum(quantities);
     return tfp * pow(innerSum, 1 / substitutionParam - 1)
         * shareParams(idx) * pow(quantities(idx), substitutionParam - 1);
 }
 
+Eigen::ArrayXd CES::get_params() const {
+    Eigen::ArrayXd params(numInputs + 2);
+    params << tfp, shareParams, substitutionParam;
+    return params;
+}
+
+void CES::set_params(const Eigen::ArrayXd& params) {
+    assert(params.size() == numInputs + 2);
+    tfp = params(0);
+    // shareParams are taken as is, since they were normalized when first set
+    shareParams = params.segment(1, numInputs);
+    substitutionParam = params(numInputs + 1);
+}
+
 
 
 
@@ -133,10 +197,24 @@ ProfitFunc::ProfitFunc(
     assert(numInputs == this->prodFunc->numInputs);
 }
 
-double ProfitFunc::f(const Eigen::ArrayXd& quantities) const {
+double ProfitFunc::f(const Eigen::Ref<const Eigen::ArrayXd>& quantities) const {
     return price * prodFunc->f(quantities) - costFunc.f(quantities);
 }
 
-double ProfitFunc::df(const Eigen::ArrayXd& quantities, unsigned int idx) const {
+double ProfitFunc::df(const Eigen::Ref<const Eigen::ArrayXd>& quantities, unsigned int idx) const {
     return price * prodFunc->df(quantities, idx) - costFunc.df(quantities, idx);
 }
+
+Eigen::ArrayXd ProfitFunc::get_params() const {
+    Eigen::ArrayXd prodFuncParams = prodFunc->get_params();
+    Eigen::ArrayXd params(1 + numInputs + prodFuncParams.size());
+    params << price, costFunc.productivities, prodFuncParams;
+    return params;
+}
+
+void ProfitFunc::set_params(const Eigen::ArrayXd& params) {
+    assert(params.size() > numInputs);
+    price = params(0);
+    costFunc.set_params(params.segment(1, numInputs));
+    prodFunc->set_params(params.tail(params.size() - 1 - numInputs));
+}
@@ -16,9 +16,14 @@ public:
     virtual ~VecToScalar() {}
     VecToScalar(unsigned int numInputs) : numInputs(numInputs) {}
     // f is the function managed by VecToScalar, it is scalar-valued function of vector of doubles
-    virtual double f(const Eigen::ArrayXd& quantities) const = 0;
+    virtual double f(const Eigen::Ref<const Eigen::ArrayXd>& quantities) const = 0;
     // df is the derivative of f with respect to the idx'th input quantity
-    virtual double df(const Eigen::ArrayXd& quantities, unsigned int idx) const = 0;
+    virtual double df(const Eigen::Ref<const Eigen::ArrayXd>& quantities, unsigned int idx) const = 0;
+    // the function's parameters flattened into one array, e.g. to be saved in an EconomySnapshot
+    // set_params takes an array laid out the same way as the one get_params returns
+    // by default a function has no parameters
+    virtual Eigen::ArrayXd get_params() const;
+    virtual void set_params(const Eigen::ArrayXd& params);
 
     void check_no_length_change(const Eigen::ArrayXd& candidate) const;
     unsigned int numInputs;
@@ -30,8 +35,11 @@ public:
     // Perfect substitutes
     Linear(unsigned int numInputs);
     Linear(const Eigen::ArrayXd& productivities);
-    virtual double f(const Eigen::ArrayXd& quantities) const override;
-    virtual double df(const Eigen::ArrayXd& quantities, unsigned int idx) const override;
+    virtual double f(const Eigen::Ref<const Eigen::ArrayXd>& quantities) const override;
+    virtual double df(const Eigen::Ref<const Eigen::ArrayXd>& quantities, unsigned int idx) const override;
+    // [productivities]
+    virtual Eigen::ArrayXd get_params() const override;
+    virtual void set_params(const Eigen::ArrayXd& params) override;
 
     Eigen::ArrayXd productivities;
 };
@@ -41,8 +49,11 @@ class CobbDouglas : public VecToScalar {
 public:
     CobbDouglas(unsigned int numInputs);
     CobbDouglas(double tfp, const Eigen::ArrayXd& elasticities);
-    virtual double f(const Eigen::ArrayXd& quantities) const;
-    virtual double df(const Eigen::ArrayXd& quantities, unsigned int idx) const;
+    virtual double f(const Eigen::Ref<const Eigen::ArrayXd>& quantities) const;
+    virtual double df(const Eigen::Ref<const Eigen::ArrayXd>& quantities, unsigned int idx) const;
+    // [tfp, elasticities]
+    virtual Eigen::ArrayXd get_params() const override;
+    virtual void set_params(const Eigen::ArrayXd& params) override;
 
     double tfp;
     Eigen::ArrayXd elasticities;
@@ -58,8 +69,11 @@ public:
 class StoneGeary : public CobbDouglas {
 public:
     StoneGeary(double tfp, const Eigen::ArrayXd& elasticities, const Eigen::ArrayXd& thresholdParams);
-    virtual double f(const Eigen::ArrayXd& quantities) const;
-    virtual double df(const Eigen::ArrayXd& quantities, unsigned int idx) const;
+    virtual double f(const Eigen::Ref<const Eigen::ArrayXd>& quantities) const;
+    virtual double df(const Eigen::Ref<const Eigen::ArrayXd>& quantities, unsigned int idx) const;
+    // [tfp, elasticities, thresholdParams]
+    virtual Eigen::ArrayXd get_params() const override;
+    virtual void set_params(const Eigen::ArrayXd& params) override;
 
     Eigen::ArrayXd thresholdParams;
 };
@@ -69,8 +83,11 @@ class Leontief : public VecToScalar {
 public:
     // Perfect compliments
     Leontief(const Eigen::ArrayXd& productivities);
-    virtual double f(const Eigen::ArrayXd& quantities) const;
-    virtual double df(const Eigen::ArrayXd& quantities, unsigned int idx) const;
+    virtual double f(const Eigen::Ref<const Eigen::ArrayXd>& quantities) const;
+    virtual double df(const Eigen::Ref<const Eigen::ArrayXd>& quantities, unsigned int idx) const;
+    // [productivities]
+    virtual Eigen::ArrayXd get_params() const override;
+    virtual void set_params(const Eigen::ArrayXd& params) override;
 
     Eigen::ArrayXd productivities;
 };
@@ -83,13 +100,16 @@ public:
     // elast = infty -> Linear
     // elast = 0 -> Leontief
     CES(double tfp, const Eigen::ArrayXd& shareParams, double elasticityOfSubstitution);
-    virtual double f(const Eigen::ArrayXd& quantities) const;
-    virtual double df(const Eigen::ArrayXd& quantities, unsigned int idx) const;
+    virtual double f(const Eigen::Ref<const Eigen::ArrayXd>& quantities) const;
+    virtual double df(const Eigen::Ref<const Eigen::ArrayXd>& quantities, unsigned int idx) const;
+    // [tfp, shareParams, substitutionParam], the same layout the neural decision makers use
+    virtual Eigen::ArrayXd get_params() const override;
+    virtual void set_params(const Eigen::ArrayXd& params) override;
 
     double tfp;
     Eigen::ArrayXd shareParams;
     double substitutionParam;
-    double get_inner_sum(const Eigen::ArrayXd& quantities) const;
+    double get_inner_sum(const Eigen::Ref<const Eigen::ArrayXd>& quantities) const;
 };
 
 
@@ -97,8 +117,11 @@ class ProfitFunc : public VecToScalar {
 public:
     // Encapsulates another VecToScalar to return the profit for different levels of production
     ProfitFunc(double price, const Eigen::ArrayXd& factorPrices, std::shared_ptr<VecToScalar> prodFunc);
-    virtual double f(const Eigen::ArrayXd& quantities) const;
-    virtual double df(const Eigen::ArrayXd& quantities, unsigned int idx) const;
+    virtual double f(const Eigen::Ref<const Eigen::ArrayXd>& quantities) const;
+    virtual double df(const Eigen::Ref<const Eigen::ArrayXd>& quantities, unsigned int idx) const;
+    // [price, factor prices, prodFunc's params]
+    virtual Eigen::ArrayXd get_params() const override;
+    virtual void set_params(const Eigen::ArrayXd& params) override;
 
     double price;
     std::shared_ptr<VecToScalar> prodFunc;
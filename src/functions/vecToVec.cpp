@@ -14,7 +14,7 @@ SumOfVecToVec::SumOfVecToVec(
     }
 }
 
-Eigen::ArrayXd SumOfVecToVec::f(const Eigen::ArrayXd& quantities) const {
+Eigen::ArrayXd SumOfVecToVec::f(const Eigen::Ref<const Eigen::ArrayXd>& quantities) const {
     Eigen::ArrayXd out = innerFunctions[0]->f(quantities);
     for (unsigned int i = 1; i < numInnerFunctions; i++) {
         out += innerFunctions[i]->f(quantities);
@@ -22,7 +22,7 @@ Eigen::ArrayXd SumOfVecToVec::f(const Eigen::ArrayXd& quantities) const {
     return out;
 }
 
-double SumOfVecToVec::df(const Eigen::ArrayXd& quantities, unsigned int i, unsigned int j) const {
+double SumOfVecToVec::df(const Eigen::Ref<const Eigen::ArrayXd>& quantities, unsigned int i, unsigned int j) const {
     double out = innerFunctions[i]->df(quantities, i, j);
     for (unsigned int k = 1; k < numInnerFunctions; k++) {
         out += innerFunctions[k]->df(quantities, i, j);
@@ -30,6 +30,33 @@ double SumOfVecToVec::df(const Eigen::ArrayXd& quantities, unsigned int i, unsig
     return out;
 }
 
+Eigen::ArrayXd SumOfVecToVec::get_params() const {
+    std::vector<Eigen::ArrayXd> innerParams;
+    unsigned int size = 0;
+    for (const auto& innerFunction : innerFunctions) {
+        innerParams.push_back(innerFunction->get_params());
+        size += innerParams.back().size();
+    }
+    Eigen::ArrayXd params(size);
+    unsigned int start = 0;
+    for (const auto& p : innerParams) {
+        params.segment(start, p.size()) = p;
+        start += p.size();
+    }
+    return params;
+}
+
+void SumOfVecToVec::set_params(const Eigen::ArrayXd& params) {
+    unsigned int start = 0;
+    for (auto& innerFunction : innerFunctions) {
+        // inner functions' parameter counts don't change, so their current params tell us how many to take
+        unsigned int size = innerFunction->get_params().size();
+        innerFunction->set_params(params.segment(start, size));
+        start += size;
+    }
+    assert(start == params.size());
+}
+
 
 std::shared_ptr<SumOfVecToVec> create_CES_VecToVec(
     std::vector<double> tfps,
@@ -1,6 +1,7 @@
 #ifndef VECTOVEC_H
 #define VECTOVEC_H
 
+#include <assert.h>
 #include <memory>
 #include <vector>
 #include <Eigen/Dense>
@@ -11,9 +12,12 @@ class VecToVec {
 public:
     virtual ~VecToVec() {}
     VecToVec(unsigned int numInputs, unsigned int numOutputs) : numInputs(numInputs), numOutputs(numOutputs) {}
-    virtual Eigen::ArrayXd f(const Eigen::ArrayXd& quantities) const = 0;
+    virtual Eigen::ArrayXd f(const Eigen::Ref<const Eigen::ArrayXd>& quantities) const = 0;
     // df returns derivative of ith output w.r.t. jth input variable
-    virtual double df(const Eigen::ArrayXd& quantities, unsigned int i, unsigned int j) const = 0;
+    virtual double df(const Eigen::Ref<const Eigen::ArrayXd>& quantities, unsigned int i, unsigned int j) const = 0;
+    // analogous to VecToScalar::get_params & set_params
+    virtual Eigen::ArrayXd get_params() const { return Eigen::ArrayXd(0); }
+    virtual void set_params(const Eigen::ArrayXd& params) { assert(params.size() == 0); }
 
     unsigned int numInputs;
     unsigned int numOutputs;
@@ -36,13 +40,13 @@ public:
         // implicitly assumes numOutputs = 1 and outputIndex = 0
     ) : VToVFromVToS(vecToScalar, 1, 0) {}
 
-    Eigen::ArrayXd f(const Eigen::ArrayXd& quantities) const override {
+    Eigen::ArrayXd f(const Eigen::Ref<const Eigen::ArrayXd>& quantities) const override {
         Eigen::ArrayXd out = Eigen::ArrayXd::Zero(numOutputs);
         out(outputIndex) = vecToScalar->f(quantities);
         return out;
     }
 
-    double df(const Eigen::ArrayXd& quantities, unsigned int i, unsigned int j) const override {
+    double df(const Eigen::Ref<const Eigen::ArrayXd>& quantities, unsigned int i, unsigned int j) const override {
         if (i == outputIndex) {
             return vecToScalar->df(quantities, j);
         }
@@ -51,6 +55,14 @@ public:
         }
     }
 
+    Eigen::ArrayXd get_params() const override {
+        return vecToScalar->get_params();
+    }
+
+    void set_params(const Eigen::ArrayXd& params) override {
+        vecToScalar->set_params(params);
+    }
+
     std::shared_ptr<VToS> vecToScalar;
     unsigned int outputIndex;
 };
@@ -61,8 +73,11 @@ class SumOfVecToVec : public VecToVec {
     // output will be sum of outputs for VecToVecs in the list
 public:
     SumOfVecToVec(std::vector<std::shared_ptr<VecToVec>> innerFunctions);
-    Eigen::ArrayXd f(const Eigen::ArrayXd& quantities) const override;
-    double df(const Eigen::ArrayXd& quantities, unsigned int i, unsigned int j) const override;
+    Eigen::ArrayXd f(const Eigen::Ref<const Eigen::ArrayXd>& quantities) const override;
+    double df(const Eigen::Ref<const Eigen::ArrayXd>& quantities, unsigned int i, unsigned int j) const override;
+    // the inner functions' params, concatenated in order
+    Eigen::ArrayXd get_params() const override;
+    void set_params(const Eigen::ArrayXd& params) override;
 
     std::vector<std::shared_ptr<VecToVec>> innerFunctions;
     unsigned int numInnerFunctions;
@@ -260,9 +260,7 @@ torch::Tensor AdvantageActorCritic::get_loss_from_logProba(
             }
         }
         else {
-            util::print_status(
-                agent, "WARNING: Can't find in log probas at time " + std::to_string(t)
-            );
+            trace::record(3, trace::Event::MissingTrainingData, agent->get_id(), agent->get_time(), t);
         }
     }
     return loss;
@@ -277,7 +275,7 @@ std::pair<torch::Tensor, torch::Tensor> AdvantageActorCritic::get_advantage_for_
     // advantage is realized utility minus predicted value in each state
     // Then critic loss is sum of squared advantage
     auto loss = torch::tensor(0.0);
-    auto advantage = torch::empty(handler->time);
+    auto advantage = torch::empty(handler->time.load());
     auto q = torch::tensor(0.0, torch::requires_grad(true));
     for (int t = handler->time - 1; t >= 0; t--) {
         auto reward_search = handler->rewards[t].find(person);
@@ -294,10 +292,7 @@ std::pair<torch::Tensor, torch::Tensor> AdvantageActorCritic::get_advantage_for_
             loss = loss + advantage_t.pow(2);
         }
         else {
-            util::print_status(
-                person,
-                "WARNING: Can't find in rewards || value map at time " + std::to_string(t)
-            );
+            trace::record(3, trace::Event::MissingTrainingData, person->get_id(), person->get_time(), t);
         }
     }
     return std::make_pair(loss, advantage);
@@ -378,10 +373,7 @@ std::pair<torch::Tensor, torch::Tensor> AdvantageActorCritic::get_advantage_for_
             loss = loss + advantage_t.pow(2);
         }
         else {
-            util::print_status(
-                firm,
-                "WARNING: Can't find in rewards || value map at time " + std::to_string(t)
-            );
+            trace::record(3, trace::Event::MissingTrainingData, firm->get_id(), firm->get_time(), t);
         }
     }
     return std::make_pair(loss, advantage);
@@ -485,52 +477,24 @@ void AdvantageActorCritic::get_loss_for_firms_multithreaded_(
 double AdvantageActorCritic::get_loss_for_persons_multithreaded() {
     double loss = 0.0;
     auto persons = handler->economy->get_persons();
-    std::vector<unsigned int> indices = util::get_indices_for_multithreading(persons.size());
-    std::vector<std::thread> threads;
-    threads.reserve(constants::numThreads);
-    for (unsigned int i = 0; i < constants::numThreads; i++) {
-        if (indices[i] != indices[i+1]) {
-            threads.push_back(
-                std::thread(
-                    &AdvantageActorCritic::get_loss_for_persons_multithreaded_,
-                    this,
-                    persons,
-                    indices[i],
-                    indices[i+1],
-                    &loss
-                )
-            );
+    handler->economy->get_threadPool()->run(
+        persons.size(),
+        [this, &persons, &loss](unsigned int startIdx, unsigned int endIdx) {
+            get_loss_for_persons_multithreaded_(persons, startIdx, endIdx, &loss);
         }
-    }
-    for (unsigned int i = 0; i < threads.size(); i++) {
-        threads[i].join();
-    }
+    );
     return loss;
 };
 
 double AdvantageActorCritic::get_loss_for_firms_multithreaded() {
     double loss = 0.0;
     auto firms = handler->economy->get_firms();
-    std::vector<unsigned int> indices = util::get_indices_for_multithreading(firms.size());
-    std::vector<std::thread> threads;
-    threads.reserve(constants::numThreads);
-    for (unsigned int i = 0; i < constants::numThreads; i++) {
-        if (indices[i] != indices[i+1]) {
-            threads.push_back(
-                std::thread(
-                    &AdvantageActorCritic::get_loss_for_firms_multithreaded_,
-                    this,
-                    firms,
-                    indices[i],
-                    indices[i+1],
-                    &loss
-                )
-            );
+    handler->economy->get_threadPool()->run(
+        firms.size(),
+        [this, &firms, &loss](unsigned int startIdx, unsigned int endIdx) {
+            get_loss_for_firms_multithreaded_(firms, startIdx, endIdx, &loss);
         }
-    }
-    for (unsigned int i = 0; i < threads.size(); i++) {
-        threads[i].join();
-    }
+    );
     return loss;
 }
 
@@ -6,7 +6,7 @@
 namespace neural {
 
 
-torch::Tensor eigenToTorch(Eigen::ArrayXd eigenArray) {
+torch::Tensor eigenToTorch(const Eigen::Ref<const Eigen::ArrayXd>& eigenArray) {
     auto t = torch::empty(eigenArray.rows());
     float* data = t.data_ptr<float>();
 
@@ -24,24 +24,58 @@ Eigen::ArrayXd torchToEigen(torch::Tensor tensor) {
     return Eigen::Map<Eigen::ArrayXd>(tensor.data_ptr<double>(), tensor.numel());
 }
 
-std::pair<torch::Tensor, torch::Tensor> sample_normal(const torch::Tensor& params) {
+torch::Tensor randn(int64_t n, util::Philox& rng) {
+    std::normal_distribution<float> dist(0, 1);
+    auto t = torch::empty(n);
+    float* data = t.data_ptr<float>();
+    for (int64_t i = 0; i < n; i++) {
+        data[i] = dist(rng);
+    }
+    return t;
+}
+
+torch::Tensor rand(torch::IntArrayRef sizes, util::Philox& rng) {
+    auto t = torch::empty(sizes);
+    float* data = t.data_ptr<float>();
+    for (int64_t i = 0; i < t.numel(); i++) {
+        data[i] = rng.uniform();
+    }
+    return t;
+}
+
+torch::Tensor randint(int64_t high, int64_t n, util::Philox& rng) {
+    return randint(0, high, n, rng);
+}
+
+torch::Tensor randint(int64_t low, int64_t high, int64_t n, util::Philox& rng) {
+    std::uniform_int_distribution<int64_t> dist(low, high - 1);
+    auto t = torch::empty(n, torch::dtype(torch::kInt64));
+    int64_t* data = t.data_ptr<int64_t>();
+    for (int64_t i = 0; i < n; i++) {
+        data[i] = dist(rng);
+    }
+    return t;
+}
+
+
+std::pair<torch::Tensor, torch::Tensor> sample_normal(const torch::Tensor& params, util::Philox& rng) {
     // std::cout << "params: " << params << std::endl;
     auto mu = params.index({"...", 0});
     auto sigma = torch::exp(params.index({"...", 1}));
     int size = (params.dim() > 1) ? params.size(-2) : 1;
-    auto normal_vals = torch::randn(size) * sigma + mu;
+    auto normal_vals = randn(size, rng) * sigma + mu;
     auto log_proba = -0.5 * torch::pow((normal_vals - mu) / sigma, 2) - torch::log(sigma * SQRT2PI);
     // std::cout << "logProba: " << log_proba << std::endl;
     return std::make_pair(normal_vals, log_proba);
 }
 
-std::pair<torch::Tensor, torch::Tensor> sample_logitNormal(const torch::Tensor& params) {
-    auto pair = sample_normal(params);
+std::pair<torch::Tensor, torch::Tensor> sample_logitNormal(const torch::Tensor& params, util::Philox& rng) {
+    auto pair = sample_normal(params, rng);
     return std::make_pair(torch::sigmoid(pair.first), pair.second);
 }
 
-std::pair<torch::Tensor, torch::Tensor> sample_logNormal(const torch::Tensor& params) {
-    auto pair = sample_normal(params);
+std::pair<torch::Tensor, torch::Tensor> sample_logNormal(const torch::Tensor& params, util::Philox& rng) {
+    auto pair = sample_normal(params, rng);
     return std::make_pair(torch::exp(pair.first), pair.second);
 }
 
@@ -234,20 +268,30 @@ DecisionNetHandler::DecisionNetHandler(
 
 
 void DecisionNetHandler::update_encodedOffers() {
-    offers = economy->get_market();
-    unsigned int numOffers = offers.size();
+    const auto& market = economy->get_market();
+    // only offers available at the start of the step, already in an order that doesn't depend on slots
+    offers = &economy->get_offerSnapshot().get_offers();
+    unsigned int numOffers = offers->size();
 
     torch::Tensor goods = torch::empty(
         {numOffers, economy->get_numGoods()}
     );
     torch::Tensor prices = torch::empty({numOffers, 1});
 
+    // fill the tensors' rows in place, rather than building a tensor per offer
+    unsigned int numGoods = economy->get_numGoods();
+    float* goodsData = goods.data_ptr<float>();
+    float* pricesData = prices.data_ptr<float>();
     for (int i = 0; i < numOffers; i++) {
-        auto offer = offers[i].lock();
-        // set goods
-        goods[i] = eigenToTorch(offer->quantities).squeeze(-1);
-        // set prices
-        prices[i] = offer->price;
+        const Offer* offer = market.get((*offers)[i]);
+        // only stale if the market was compacted after the snapshot, i.e. when encoding between steps
+        if (offer == nullptr) {
+            Eigen::Map<Eigen::ArrayXf>(goodsData + i * numGoods, numGoods).setZero();
+            pricesData[i] = 0.0f;
+            continue;
+        }
+        Eigen::Map<Eigen::ArrayXf>(goodsData + i * numGoods, numGoods) = offer->quantities.cast<float>();
+        pricesData[i] = offer->price;
     }
     auto inputFeatures = torch::cat({goods, prices}, 1);
 
@@ -257,16 +301,17 @@ void DecisionNetHandler::update_encodedOffers() {
 
 
 void DecisionNetHandler::update_encodedJobOffers() {
-    jobOffers = economy->get_jobMarket();
-    unsigned int numOffers = jobOffers.size();
+    const auto& jobMarket = economy->get_jobMarket();
+    jobOffers = &economy->get_jobOfferSnapshot().get_offers();
+    unsigned int numOffers = jobOffers->size();
 
     torch::Tensor labors = torch::empty({numOffers, 1});
     torch::Tensor wages = torch::empty({numOffers, 1});
 
     for (int i = 0; i < numOffers; i++) {
-        auto jobOffer = jobOffers[i].lock();
-        labors[i] = jobOffer->labor;
-        wages[i] = jobOffer->wage;
+        const JobOffer* jobOffer = jobMarket.get((*jobOffers)[i]);
+        labors[i] = (jobOffer != nullptr) ? jobOffer->labor : 0.0;
+        wages[i] = (jobOffer != nullptr) ? jobOffer->wage : 0.0;
     }
     auto inputFeatures = torch::cat({labors, wages}, 1);
 
@@ -301,9 +346,20 @@ void DecisionNetHandler::time_step() {
 }
 
 void DecisionNetHandler::synchronize_time(const std::shared_ptr<Agent>& caller) {
+    // the first agent of a step encodes the markets; the rest see the new time without locking
+    int callerTime = caller->get_time();
+    if (callerTime <= time.load(std::memory_order_acquire)) {
+        return;
+    }
     std::lock_guard<std::mutex> lock(myMutex);
-    if (caller->get_time() > time) {
+    if (callerTime > time.load(std::memory_order_relaxed)) {
         time_step();
+        // catch up in one go, e.g. with an economy restored from a snapshot, which starts at a later time
+        // memory is indexed by time - 1, so each skipped step still gets its own (empty) frame
+        while (values.size() < static_cast<std::size_t>(callerTime)) {
+            push_back_memory();
+        }
+        time.store(callerTime, std::memory_order_release);
     }
 }
 
@@ -324,58 +380,77 @@ void DecisionNetHandler::reset(std::shared_ptr<NeuralEconomy> newEconomy) {
     time_step();
 }
 
-torch::Tensor DecisionNetHandler::generate_offerIndices() {
-    if (numEncodedOffers == 0) {
-        return torch::tensor({}, torch::dtype(torch::kInt64));
+// [first, last) of the encoded offers caller can take: all of them, or only its own region's
+// if the economy doesn't allow trade across regions (the snapshot is sorted by region)
+template <typename T>
+std::pair<int64_t, int64_t> get_tradable(
+    const MarketSnapshot<T>& snapshot,
+    const std::vector<Handle<T>>* encoded,
+    const Economy& economy,
+    const Agent* caller
+) {
+    int64_t numEncoded = (encoded != nullptr) ? encoded->size() : 0;
+    // the snapshot's regions only line up with what was encoded if it hasn't been retaken since
+    if (economy.get_crossRegionTrade() || encoded != &snapshot.get_offers()) {
+        return {0, numEncoded};
     }
-    // get random indices of offers to consider
-    return torch::randint(
-        0, numEncodedOffers, purchaseNet->offerEncoder->stackSize, torch::dtype(torch::kInt64)
-    );
+    const Handle<T>* first = encoded->data();
+    return {snapshot.begin(caller->get_region()) - first, snapshot.end(caller->get_region()) - first};
 }
 
-torch::Tensor DecisionNetHandler::generate_jobOfferIndices() {
-    if (numEncodedJobOffers == 0) {
+// stackSize random indices of offers caller can take, or none if there aren't any
+template <typename T>
+torch::Tensor sample_tradable(
+    const MarketSnapshot<T>& snapshot,
+    const std::vector<Handle<T>>* encoded,
+    const Economy& economy,
+    Agent* caller,
+    int64_t stackSize
+) {
+    auto range = get_tradable(snapshot, encoded, economy, caller);
+    if (range.first >= range.second) {
         return torch::tensor({}, torch::dtype(torch::kInt64));
     }
-    // get random indices of offers to consider
-    return torch::randint(
-        0, numEncodedJobOffers, laborSearchNet->offerEncoder->stackSize, torch::dtype(torch::kInt64)
+    return randint(range.first, range.second, stackSize, caller->get_rng());
+}
+
+torch::Tensor DecisionNetHandler::generate_offerIndices(Agent* caller) {
+    return sample_tradable(
+        economy->get_offerSnapshot(), offers, *economy, caller, purchaseNet->offerEncoder->stackSize
     );
 }
 
-torch::Tensor DecisionNetHandler::firm_generate_offerIndices() {
-    if (numEncodedOffers == 0) {
-        return torch::tensor({}, torch::dtype(torch::kInt64));
-    }
-    // get random indices of offers to consider
-    return torch::randint(
-        0, numEncodedOffers, firmPurchaseNet->offerEncoder->stackSize, torch::dtype(torch::kInt64)
+torch::Tensor DecisionNetHandler::generate_jobOfferIndices(Agent* caller) {
+    return sample_tradable(
+        economy->get_jobOfferSnapshot(), jobOffers, *economy, caller, laborSearchNet->offerEncoder->stackSize
     );
 }
 
-torch::Tensor DecisionNetHandler::firm_generate_jobOfferIndices() {
-    if (numEncodedJobOffers == 0) {
-        return torch::tensor({}, torch::dtype(torch::kInt64));
-    }
-    // get random indices of offers to consider
-    return torch::randint(
-        0, numEncodedJobOffers, jobOfferNet->offerEncoder->stackSize, torch::dtype(torch::kInt64)
+torch::Tensor DecisionNetHandler::firm_generate_offerIndices(Agent* caller) {
+    return sample_tradable(
+        economy->get_offerSnapshot(), offers, *economy, caller, firmPurchaseNet->offerEncoder->stackSize
+    );
+}
+
+torch::Tensor DecisionNetHandler::firm_generate_jobOfferIndices(Agent* caller) {
+    return sample_tradable(
+        economy->get_jobOfferSnapshot(), jobOffers, *economy, caller, jobOfferNet->offerEncoder->stackSize
     );
 }
 
 
 std::pair<std::vector<Order<Offer>>, torch::Tensor> DecisionNetHandler::create_offer_requests(
+    Agent* caller,
     const torch::Tensor& offerIndices, // dtype = kInt64
     const torch::Tensor& purchase_probas
 ) {
-    auto to_purchase = (torch::rand(purchase_probas.sizes()) < purchase_probas);
+    auto to_purchase = (rand(purchase_probas.sizes(), caller->get_rng()) < purchase_probas);
 
     std::vector<Order<Offer>> toRequest;
     auto logProba = torch::tensor(0.0);
     for (int i = 0; i < to_purchase.size(0); i++) {
         if (to_purchase[i].item<bool>()) {
-            auto offer = offers[offerIndices[i].item<int>()];
+            auto offer = (*offers)[offerIndices[i].item<int>()];
             toRequest.push_back(Order<Offer>(offer, 1));
             logProba = logProba + torch::log(purchase_probas[i]);
         }
@@ -406,7 +481,7 @@ std::vector<Order<Offer>> DecisionNetHandler::get_offers_to_request(
         offerIndices, utilParams, budget, labor, inventory, purchaseNet, encodedOffers
     );
 
-    auto request_proba_pair = create_offer_requests(offerIndices, probas);
+    auto request_proba_pair = create_offer_requests(caller, offerIndices, probas);
     // std::cout << "Recording logProba at time " << time << " for agent " << caller << std::endl;
     {
         std::lock_guard<std::mutex> lock(purchaseNetMutex);
@@ -434,7 +509,7 @@ std::vector<Order<Offer>> DecisionNetHandler::firm_get_offers_to_request(
         offerIndices, prodFuncParams, budget, labor, inventory, firmPurchaseNet, encodedOffers
     );
 
-    auto request_proba_pair = create_offer_requests(offerIndices, probas);
+    auto request_proba_pair = create_offer_requests(caller, offerIndices, probas);
     {
         std::lock_guard<std::mutex> lock(firmPurchaseNetMutex);
         firmPurchaseNetLogProba[time-1][caller] = request_proba_pair.second;
@@ -444,16 +519,17 @@ std::vector<Order<Offer>> DecisionNetHandler::firm_get_offers_to_request(
 
 
 std::pair<std::vector<Order<JobOffer>>, torch::Tensor> DecisionNetHandler::create_joboffer_requests(
+    Agent* caller,
     const torch::Tensor& offerIndices, // dtype = kInt64
     const torch::Tensor& job_probas
 ) {
-    auto to_take = (torch::rand(job_probas.sizes()) < job_probas);
+    auto to_take = (rand(job_probas.sizes(), caller->get_rng()) < job_probas);
 
     std::vector<Order<JobOffer>> toRequest;
     auto logProba = torch::tensor(0.0);
     for (int i = 0; i < to_take.size(0); i++) {
         if (to_take[i].item<bool>()) {
-            auto jobOffer = jobOffers[offerIndices[i].item<int>()];
+            auto jobOffer = (*jobOffers)[offerIndices[i].item<int>()];
             toRequest.push_back(Order<JobOffer>(jobOffer, 1));
             logProba = logProba + torch::log(job_probas[i]);
         }
@@ -484,7 +560,7 @@ std::vector<Order<JobOffer>> DecisionNetHandler::get_joboffers_to_request(
         jobOfferIndices, utilParams, money, labor, inventory, laborSearchNet, encodedJobOffers
     );
 
-    auto request_proba_pair = create_joboffer_requests(jobOfferIndices, probas);
+    auto request_proba_pair = create_joboffer_requests(caller, jobOfferIndices, probas);
     {
         std::lock_guard<std::mutex> lock(laborSearchNetMutex);
         laborSearchNetLogProba[time-1][caller] = request_proba_pair.second;
@@ -506,7 +582,7 @@ Eigen::ArrayXd DecisionNetHandler::get_consumption_proportions(
     auto labor_ = torch::tensor({labor});
     auto inventory_ = eigenToTorch(inventory);
     auto consumption_pair = sample_logitNormal(
-        consumptionNet->forward(utilParams_, money_, labor_, inventory_)
+        consumptionNet->forward(utilParams_, money_, labor_, inventory_), caller->get_rng()
     );
     {
         std::lock_guard<std::mutex> lock(consumptionNetMutex);
@@ -529,7 +605,7 @@ Eigen::ArrayXd DecisionNetHandler::get_production_proportions(
     auto labor_ = torch::tensor({labor});
     auto inventory_ = eigenToTorch(inventory);
     auto production_pair = sample_logitNormal(
-        productionNet->forward(prodFuncParams_, money_, labor_, inventory_)
+        productionNet->forward(prodFuncParams_, money_, labor_, inventory_), caller->get_rng()
     );
     {
         std::lock_guard<std::mutex> lock(productionNetMutex);
@@ -584,11 +660,11 @@ std::pair<Eigen::ArrayXd, Eigen::ArrayXd> DecisionNetHandler::choose_offers(
     );
 
     auto amounts_params = netOutput.index({"...", torch::tensor({0, 1})});
-    auto amount_pair = sample_logitNormal(amounts_params);
+    auto amount_pair = sample_logitNormal(amounts_params, caller->get_rng());
     auto amounts = torchToEigen(amount_pair.first) * inventory;
 
     auto prices_params = netOutput.index({"...", torch::tensor({2, 3})});
-    auto price_pair = sample_logNormal(prices_params);
+    auto price_pair = sample_logNormal(prices_params, caller->get_rng());
     auto prices = torchToEigen(price_pair.first);
 
     {
@@ -622,11 +698,11 @@ std::pair<double, double> DecisionNetHandler::choose_job_offers(
     );
 
     auto labor_params = netOutput.index({"...", torch::tensor({0, 1})});
-    auto labor_pair = sample_logNormal(labor_params);
+    auto labor_pair = sample_logNormal(labor_params, caller->get_rng());
     double totalLabor = labor_pair.first.item<double>();
 
     auto wage_params = netOutput.index({"...", torch::tensor({2, 3})});
-    auto wage_pair = sample_logNormal(wage_params);
+    auto wage_pair = sample_logNormal(wage_params, caller->get_rng());
     double wage = wage_pair.first.item<double>();
     // clip wage to avoid inf values
     if (wage > constants::largeNumber) {
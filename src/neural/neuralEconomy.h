@@ -6,6 +6,7 @@
 #include <vector>
 #include <string>
 #include <unordered_map>
+#include <atomic>
 #include <mutex>
 #include <utility>
 #include <Eigen/Dense>
@@ -90,9 +91,9 @@ public:
     NeuralFirmDecisionMaker(std::weak_ptr<DecisionNetHandler> guide);
 
     virtual Eigen::ArrayXd choose_production_inputs() override;
-    virtual std::vector<std::shared_ptr<Offer>> choose_good_offers() override;
+    virtual std::vector<Offer> choose_good_offers() override;
     virtual std::vector<Order<Offer>> choose_goods() override;
-    virtual std::vector<std::shared_ptr<JobOffer>> choose_job_offers() override;
+    virtual std::vector<JobOffer> choose_job_offers() override;
 
 	std::weak_ptr<DecisionNetHandler> guide;
 
@@ -119,21 +120,30 @@ protected:
 
 // FROM HERE ON ARE DEFINED IN decisionNetHandler.cpp
 
-torch::Tensor eigenToTorch(Eigen::ArrayXd eigenArray);
+torch::Tensor eigenToTorch(const Eigen::Ref<const Eigen::ArrayXd>& eigenArray);
 
 Eigen::ArrayXd torchToEigen(torch::Tensor tensor);
 
+// analogues of torch::randn, torch::rand & torch::randint that draw from an agent's own stream
+// instead of torch's global generator, so results don't depend on thread scheduling
+torch::Tensor randn(int64_t n, util::Philox& rng);
+torch::Tensor rand(torch::IntArrayRef sizes, util::Philox& rng);
+// n values in [0, high), dtype = kInt64
+torch::Tensor randint(int64_t high, int64_t n, util::Philox& rng);
+// n values in [low, high)
+torch::Tensor randint(int64_t low, int64_t high, int64_t n, util::Philox& rng);
+
 // params is [batchsize] x n x 2 tensor
 // cols are {mu, logSigma} for each of n obs (note *log* sigma; sigma = exp(logSigma))
 // returns pair where first value is n sampled values from normal dist
 // and second value is log probas of those values
-std::pair<torch::Tensor, torch::Tensor> sample_normal(const torch::Tensor& params);
+std::pair<torch::Tensor, torch::Tensor> sample_normal(const torch::Tensor& params, util::Philox& rng);
 
 // same as sample_normal, but applies sigmoid function to output values
-std::pair<torch::Tensor, torch::Tensor> sample_logitNormal(const torch::Tensor& params);
+std::pair<torch::Tensor, torch::Tensor> sample_logitNormal(const torch::Tensor& params, util::Philox& rng);
 
 // same as sample_normal, but applies exp function to output values
-std::pair<torch::Tensor, torch::Tensor> sample_logNormal(const torch::Tensor& params);
+std::pair<torch::Tensor, torch::Tensor> sample_logNormal(const torch::Tensor& params, util::Philox& rng);
 
 
 torch::Tensor get_purchase_probas(
@@ -217,14 +227,17 @@ public:
 
 	torch::Tensor encodedOffers;
     int numEncodedOffers;
-	std::vector<std::weak_ptr<const Offer>> offers;
+    // the economy's snapshots of the markets at the start of the step, shared rather than copied
+    const std::vector<OfferHandle>* offers = nullptr;
 
     torch::Tensor encodedJobOffers;
     int numEncodedJobOffers;
-    std::vector<std::weak_ptr<const JobOffer>> jobOffers;
+    const std::vector<JobOfferHandle>* jobOffers = nullptr;
 
-    int time = -1;
+    // published once the step's markets are encoded, so agents can check it without locking
+    std::atomic<int> time{-1};
 
+    // only taken by the first agent of each step, to encode the markets, & when recording rewards
     std::mutex myMutex;
     std::mutex purchaseNetMutex;
     std::mutex firmPurchaseNetMutex;
@@ -248,12 +261,13 @@ public:
 
     void reset(std::shared_ptr<NeuralEconomy> newEconomy);
 
-    torch::Tensor generate_offerIndices();
-    torch::Tensor generate_jobOfferIndices();
-    torch::Tensor firm_generate_offerIndices();
-    torch::Tensor firm_generate_jobOfferIndices();
+    torch::Tensor generate_offerIndices(Agent* caller);
+    torch::Tensor generate_jobOfferIndices(Agent* caller);
+    torch::Tensor firm_generate_offerIndices(Agent* caller);
+    torch::Tensor firm_generate_jobOfferIndices(Agent* caller);
 
     std::pair<std::vector<Order<Offer>>, torch::Tensor> create_offer_requests(
+        Agent* caller,
         const torch::Tensor& offerIndices, // dtype = kInt64
         const torch::Tensor& purchase_probas
     );
@@ -277,6 +291,7 @@ public:
     );
 
     std::pair<std::vector<Order<JobOffer>>, torch::Tensor> create_joboffer_requests(
+        Agent* caller,
         const torch::Tensor& offerIndices, // dtype = kInt64
         const torch::Tensor& job_probas
     );
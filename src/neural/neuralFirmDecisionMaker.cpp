@@ -24,8 +24,8 @@ void NeuralFirmDecisionMaker::confirm_synchronized() {
     guide_->synchronize_time(parent_);
     if (parent_->get_time() > time) {
         prodFuncParams = get_prodFuncParams();
-        myOfferIndices = guide_->firm_generate_offerIndices();
-        myJobOfferIndices = guide_->firm_generate_jobOfferIndices();
+        myOfferIndices = guide_->firm_generate_offerIndices(parent_.get());
+        myJobOfferIndices = guide_->firm_generate_jobOfferIndices(parent_.get());
         record_state_value();
         record_profit();
         time++;
@@ -108,7 +108,7 @@ Eigen::ArrayXd NeuralFirmDecisionMaker::choose_production_inputs() {
 }
 
 
-std::vector<std::shared_ptr<Offer>> NeuralFirmDecisionMaker::choose_good_offers() {
+std::vector<Offer> NeuralFirmDecisionMaker::choose_good_offers() {
     confirm_synchronized();
     auto guide_ = guide.lock();
     auto parent_ = parent.lock();
@@ -129,24 +129,21 @@ std::vector<std::shared_ptr<Offer>> NeuralFirmDecisionMaker::choose_good_offers(
     Eigen::ArrayXi numOffers = (amounts / AMOUNT_PER_OFFER).cast<int>();
 
     int numGoods = amounts.size();
-    std::vector<std::shared_ptr<Offer>> offers;
+    std::vector<Offer> offers;
+    offers.reserve(numGoods);
     for (int i = 0; i < numGoods; i++) {
         // make an Offer for each type of good
         if (numOffers(i) > 0) {
             Eigen::ArrayXd quantities = Eigen::ArrayXd::Zero(numGoods);
             quantities(i) = AMOUNT_PER_OFFER;
-            offers.push_back(
-                std::make_shared<Offer>(
-                    parent, numOffers(i), quantities, prices(i) / AMOUNT_PER_OFFER
-                )
-            );
+            offers.emplace_back(parent_.get(), numOffers(i), quantities, prices(i) / AMOUNT_PER_OFFER);
         }
     }
     return offers;
 }
 
 
-std::vector<std::shared_ptr<JobOffer>> NeuralFirmDecisionMaker::choose_job_offers() {
+std::vector<JobOffer> NeuralFirmDecisionMaker::choose_job_offers() {
     confirm_synchronized();
     auto guide_ = guide.lock();
     auto parent_ = parent.lock();
@@ -167,10 +164,8 @@ std::vector<std::shared_ptr<JobOffer>> NeuralFirmDecisionMaker::choose_job_offer
     int numOffers = laborAmount / LABOR_AMOUNT_PER_OFFER;
 
     if (numOffers > 0) {
-        std::vector<std::shared_ptr<JobOffer>> offers = {
-            std::make_shared<JobOffer>(
-                parent, numOffers, LABOR_AMOUNT_PER_OFFER, wage / LABOR_AMOUNT_PER_OFFER
-            )
+        std::vector<JobOffer> offers = {
+            JobOffer(parent_.get(), numOffers, LABOR_AMOUNT_PER_OFFER, wage / LABOR_AMOUNT_PER_OFFER)
         };
         return offers;
     }
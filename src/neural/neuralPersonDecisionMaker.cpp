@@ -20,8 +20,8 @@ void NeuralPersonDecisionMaker::confirm_synchronized() {
     guide_->synchronize_time(parent_);
     if (parent_->get_time() > time) {
         utilParams = get_utilParams();
-        myOfferIndices = guide_->generate_offerIndices();
-        myJobOfferIndices = guide_->generate_jobOfferIndices();
+        myOfferIndices = guide_->generate_offerIndices(parent_.get());
+        myJobOfferIndices = guide_->generate_jobOfferIndices(parent_.get());
         record_state_value();
         time++;
     }
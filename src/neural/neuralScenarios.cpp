@@ -25,6 +25,17 @@ std::shared_ptr<NeuralEconomy> NeuralScenario::get_economy(
     if (trainer == nullptr) {
         trainer = std::make_shared<AdvantageActorCritic>(handler);
     }
+    // reuse the same worker threads across episodes
+    if (threadPool == nullptr) {
+        threadPool = economy->get_threadPool();
+    }
+    else {
+        economy->set_threadPool(threadPool);
+    }
+    if (seed != 0) {
+        economy->set_seed(std::uint64_t(seed) + numEconomies);
+    }
+    numEconomies++;
     return economy;
 }
 
@@ -95,7 +106,7 @@ std::shared_ptr<Economy> CustomScenario::setup() {
         {"bread", "capital"}
     );
 
-    auto rng = economy->get_rng();
+    auto& rng = economy->get_rng();
     std::normal_distribution<double> randn(0, 1);
 
     for (unsigned int i = 0; i < params.numPeople; i++) {
@@ -169,6 +180,10 @@ std::shared_ptr<CustomScenario> create_scenario(
     const CustomScenarioParams& scenarioParams,
     const TrainingParams& trainingParams
 ) {
+    if (trainingParams.seed != 0) {
+        // networks are initialized from torch's global generator
+        torch::manual_seed(trainingParams.seed);
+    }
     auto handler = std::make_shared<DecisionNetHandler>(
         CustomScenario::setup_dummy(),
         trainingParams.stackSize,
@@ -194,7 +209,10 @@ std::shared_ptr<CustomScenario> create_scenario(
         trainingParams.reverseAnnealingPeriod
     );
 
-    return std::make_shared<CustomScenario>(trainer, scenarioParams);
+    auto scenario = std::make_shared<CustomScenario>(trainer, scenarioParams);
+    scenario->threadPool = std::make_shared<ThreadPool>(trainingParams.numThreads);
+    scenario->seed = trainingParams.seed;
+    return scenario;
 }
 
 
@@ -227,6 +245,9 @@ std::vector<double> train(
         util::pprint_time_elasped(2, step_time_start, step_time_end);
         util::pprint(2, "Time spent training:");
         util::pprint_time_elasped(2, step_time_end, train_time_end);
+        util::pprint(2, "Thread pool usage:");
+        scenario->threadPool->print_stats(2);
+        scenario->threadPool->reset_stats();
 
         if (std::isnan(loss)) {
             if (i >= params.checkpointEveryNEpisodes) {
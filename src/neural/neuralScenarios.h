@@ -27,6 +27,11 @@ public:
 
     std::shared_ptr<DecisionNetHandler> handler;
     std::shared_ptr<AdvantageActorCritic> trainer;
+    // shared by every economy this scenario sets up, so worker threads outlive individual episodes
+    std::shared_ptr<ThreadPool> threadPool;
+    // if nonzero, the n-th economy this scenario sets up is seeded with seed + n
+    unsigned int seed = 0;
+    unsigned int numEconomies = 0;
 
     std::shared_ptr<NeuralEconomy> get_economy(
         std::vector<std::string> goods
@@ -183,6 +188,10 @@ struct TrainingParams {
     unsigned int patienceForLRDecay = DEFAULT_PATIENCE_FOR_LR_DECAY;
     double multiplierForLRDecay = DEFAULT_MULTIPLIER_FOR_LR_DECAY;
     unsigned int reverseAnnealingPeriod = DEFAULT_REVERSE_ANNEALING_PERIOD;
+
+    unsigned int numThreads = constants::numThreads;
+    // if nonzero, network initialization & every episode are reproducible from this seed
+    unsigned int seed = 0;
 };
 
 
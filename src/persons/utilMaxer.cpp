@@ -47,41 +47,41 @@ double UtilMaxer::get_discountRate() const {
     return discountRate;
 }
 
+Eigen::ArrayXd UtilMaxer::get_params() const {
+    Eigen::ArrayXd utilParams = utilFunc->get_params();
+    Eigen::ArrayXd params(utilParams.size() + 1);
+    params << discountRate, utilParams;
+    return params;
+}
+
+void UtilMaxer::set_params(const Eigen::ArrayXd& params) {
+    assert(params.size() > 0);
+    discountRate = params(0);
+    utilFunc->set_params(params.tail(params.size() - 1));
+}
+
 std::string UtilMaxer::get_typename() const {
     return "UtilMaxer";
 }
 
-double UtilMaxer::u(double labor, const Eigen::ArrayXd& quantities) {
-    Eigen::ArrayXd inputs(utilFunc->numInputs);
+double UtilMaxer::u(double labor, const Eigen::Ref<const Eigen::ArrayXd>& quantities) {
+    // leisure, then each good
+    GoodsArray<NumGoods, 1> inputs(utilFunc->numInputs);
     inputs << 1 - labor, quantities;
     return utilFunc->f(inputs);
 }
 
-double UtilMaxer::u(const Eigen::ArrayXd& quantities) {
+double UtilMaxer::u(const Eigen::Ref<const Eigen::ArrayXd>& quantities) {
     return u(laborSupplied, quantities);
 }
 
 void UtilMaxer::buy_goods() {
-    std::vector<Order<Offer>> orders = decisionMaker->choose_goods();
-    for (auto order : orders) {
-        for (unsigned int i = 0; i < order.amount; i++) {
-            if (!respond_to_offer(order.offer)) {
-                break;
-            }
-        }
-    }
+    place_orders(decisionMaker->choose_goods());
 }
 
 
 void UtilMaxer::search_for_jobs() {
-    std::vector<Order<JobOffer>> orders = decisionMaker->choose_jobs();
-    for (auto order : orders) {
-        for (unsigned int i = 0; i < order.amount; i++) {
-            if (!respond_to_jobOffer(order.offer)) {
-                break;
-            }
-        }
-    }
+    apply_for_jobs(decisionMaker->choose_jobs());
 }
 
 
@@ -40,12 +40,15 @@ public:
         return utilMaxer;
     }
 
-    double u(double labor, const Eigen::ArrayXd& quantities);  // alias for utilFunc.f
-    double u(const Eigen::ArrayXd& quantities);  // implicitly inputs labor = laborSupplied
+    double u(double labor, const Eigen::Ref<const Eigen::ArrayXd>& quantities);  // alias for utilFunc.f
+    double u(const Eigen::Ref<const Eigen::ArrayXd>& quantities);  // implicitly inputs labor = laborSupplied
 
     std::shared_ptr<const VecToScalar> get_utilFunc() const;
     std::shared_ptr<const PersonDecisionMaker> get_decisionMaker() const;
     double get_discountRate() const;
+    // [discountRate, utilFunc's params]
+    virtual Eigen::ArrayXd get_params() const override;
+    virtual void set_params(const Eigen::ArrayXd& params) override;
 
     virtual std::string get_typename() const override;
 
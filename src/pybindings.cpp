@@ -18,60 +18,47 @@ neural::TrainingParams create_training_params(
 }
 
 void print_offer_info(
-    const std::vector<std::weak_ptr<const Offer>>& offers,
+    const MarketStats::Step& step,
     const std::vector<std::string>& goods
 ) {
-    unsigned int numGoods = goods.size();
-    std::vector<double> sumPrices(numGoods);
-    std::vector<unsigned int> counts(numGoods);
-    for (auto offer_ : offers) {
-        auto offer = offer_.lock();
-        for (unsigned int i = 0; i < numGoods; i++) {
-            if (offer->quantities(i) > 0) {
-                sumPrices[i] += (offer->quantities(i) / offer->price);
-                counts[i]++;
-            }
+    for (unsigned int i = 0; i < goods.size(); i++) {
+        std::cout << goods[i] << ": VWAP = ";
+        if (step.volume(i) > 0) {
+            std::cout << step.vwap(i);
         }
-    }
-    for (unsigned int i = 0; i < numGoods; i++) {
-        if (counts[i] > 0) {
-            std::cout << goods[i] << ": Avg. price = " << sumPrices[i] / counts[i] << " (num. offers = " << counts[i] << ")\n";
+        else {
+            std::cout << "NA";
+        }
+        std::cout << " (volume = " << step.volume(i) << ") ~ best ask = ";
+        if (step.bestAsk(i) >= 0) {
+            std::cout << step.bestAsk(i);
         }
         else {
-            std::cout << goods[i] << ": Avg. price = NA (num. offers = 0)\n";
+            std::cout << "NA";
         }
+        std::cout << " (depth = " << step.depth(i) << ")\n";
     }
 }
 
 void print_jobOffer_info(
-    std::vector<std::weak_ptr<const JobOffer>>& jobOffers
+    const MarketStats::Step& step
 ) {
-    double sumWage = 0.0;
-    for (auto jobOffer_ : jobOffers) {
-        auto jobOffer = jobOffer_.lock();
-        sumWage += jobOffer->wage / jobOffer->labor;
+    if (step.numHires > 0) {
+        std::cout << "Wage index = " << step.wageIndex << " (labor hired = " << step.laborHired << ")\n";
+    }
+    else {
+        std::cout << "[No hires]\n";
     }
-    std::cout << "Avg. wage per unit of labor = " << sumWage / jobOffers.size() << " (num. offers = " << jobOffers.size() << ")\n";
 }
 
 void print_info(const neural::NeuralEconomy& economy) {
     std::cout << "Time = " << economy.get_time() << ":\n";
-    auto offers = economy.get_market();
-    if (offers.size() > 0) {
-        auto goods = economy.get_goods();
-        print_offer_info(offers, goods);
-    }
-    else {
-        std::cout << "[No offers]\n";
-    }
-
-    auto jobOffers = economy.get_jobMarket();
-    if (jobOffers.size() > 0) {
-        print_jobOffer_info(jobOffers);
-    }
-    else {
-        std::cout << "[No job offers]\n";
+    const MarketStats::Step* step = economy.get_marketStats()->get_latest();
+    if (step == nullptr) {
+        return;
     }
+    print_offer_info(*step, economy.get_goods());
+    print_jobOffer_info(*step);
 }
 
 
@@ -82,6 +69,7 @@ void run(
     std::shared_ptr<neural::CustomScenario> scenario = neural::create_scenario(scenarioParams, trainingParams);
     scenario->handler->load_models();
     auto economy = std::static_pointer_cast<neural::NeuralEconomy>(scenario->setup());
+    economy->enable_marketStats();
     for (unsigned int t = 0; t < trainingParams.episodeLength; t++) {
         economy->time_step_no_grad();
         print_info(*economy);
@@ -89,6 +77,46 @@ void run(
 }
 
 
+void run_ensemble(
+    double* output,
+    const neural::CustomScenarioParams* scenarioParams,
+    const neural::TrainingParams* trainingParams,
+    unsigned int numEconomies
+) {
+    torch::NoGradGuard no_grad;
+    EnsembleRunner runner(std::make_shared<ThreadPool>(trainingParams->numThreads));
+    // each economy needs its own handler, so each gets its own scenario
+    std::vector<std::shared_ptr<neural::CustomScenario>> scenarios;
+    for (unsigned int i = 0; i < numEconomies; i++) {
+        neural::TrainingParams params = *trainingParams;
+        if (params.seed != 0) {
+            params.seed += i;
+        }
+        auto scenario = neural::create_scenario(*scenarioParams, params);
+        scenario->threadPool = runner.get_threadPool();
+        scenario->handler->load_models();
+        runner.add_economy(scenario->setup());
+        scenarios.push_back(scenario);
+    }
+
+    unsigned int numGoods = runner.get_economy(0)->get_numGoods();
+    unsigned int rowSize = 3 + 3 * numGoods;
+    for (unsigned int t = 0; t < trainingParams->episodeLength; t++) {
+        runner.time_step();
+        const EnsembleStats& stats = runner.get_stats();
+        double* row = output + t * rowSize;
+        row[0] = stats.meanMoney;
+        row[1] = stats.meanNumOffers;
+        row[2] = stats.meanNumJobOffers;
+        for (unsigned int i = 0; i < numGoods; i++) {
+            row[3 + i] = stats.meanInventory(i);
+            row[3 + numGoods + i] = stats.stdInventory(i);
+            row[3 + 2 * numGoods + i] = stats.meanBestPrice(i);
+        }
+    }
+}
+
+
 void train(
     double* output,
     const neural::CustomScenarioParams* scenarioParams,
@@ -3,6 +3,7 @@
 
 #include "constants.h"
 #include "neuralScenarios.h"
+#include "ensembleRunner.h"
 
 
 extern "C" {
@@ -18,6 +19,18 @@ extern "C" {
         neural::TrainingParams trainingParams
     );
 
+    // steps numEconomies independent copies of the scenario on one shared thread pool,
+    // the i-th seeded with trainingParams->seed + i (if the seed is nonzero)
+    // writes episodeLength rows of ensemble statistics to output, each row being
+    // mean money, mean num. offers, mean num. job offers,
+    // then mean inventory, std. of inventory & mean best unit price for each good
+    void run_ensemble(
+        double* output,
+        const neural::CustomScenarioParams* scenarioParams,
+        const neural::TrainingParams* trainingParams,
+        unsigned int numEconomies
+    );
+
     void train(
         double* output,
         const neural::CustomScenarioParams* scenarioParams,
@@ -0,0 +1,68 @@
+#include <cstdio>
+#include <cstring>
+#include <map>
+#include <string>
+#include <vector>
+#include "trace.h"
+
+// Decodes a trace file written by trace::dump
+// usage: readTrace <file> [--summary]
+// prints one line per event, or with --summary the number of events of each kind & per thread
+
+
+void print_records(const std::vector<trace::Record>& records) {
+    std::printf("%14s %6s %8s %6s %10s  %-26s %s\n", "ns", "thread", "agent", "time", "subject", "event", "value");
+    for (const auto& record : records) {
+        std::printf(
+            "%14llu %6u %8u %6u %10u  %-26s %g\n",
+            static_cast<unsigned long long>(record.nanoseconds),
+            record.thread,
+            record.agent,
+            record.time,
+            record.subject,
+            trace::get_name(static_cast<trace::Event>(record.event)),
+            record.value
+        );
+    }
+}
+
+void print_summary(const std::vector<trace::Record>& records) {
+    std::map<std::uint16_t, unsigned long> eventCounts;
+    std::map<std::uint16_t, unsigned long> threadCounts;
+    for (const auto& record : records) {
+        eventCounts[record.event]++;
+        threadCounts[record.thread]++;
+    }
+    std::printf("%lu events", static_cast<unsigned long>(records.size()));
+    if (!records.empty()) {
+        double seconds = (records.back().nanoseconds - records.front().nanoseconds) * 1e-9;
+        std::printf(" over %.6fs", seconds);
+    }
+    std::printf("\n\nby event:\n");
+    for (const auto& count : eventCounts) {
+        std::printf("  %-26s %lu\n", trace::get_name(static_cast<trace::Event>(count.first)), count.second);
+    }
+    std::printf("\nby thread:\n");
+    for (const auto& count : threadCounts) {
+        std::printf("  %-26u %lu\n", count.first, count.second);
+    }
+}
+
+int main(int argc, char* argv[]) {
+    if (argc < 2 || argc > 3 || (argc == 3 && std::strcmp(argv[2], "--summary") != 0)) {
+        std::fprintf(stderr, "usage: %s <file> [--summary]\n", argv[0]);
+        return 2;
+    }
+    std::vector<trace::Record> records;
+    if (!trace::read(argv[1], records)) {
+        std::fprintf(stderr, "%s: couldn't read trace from %s\n", argv[0], argv[1]);
+        return 1;
+    }
+    if (argc == 3) {
+        print_summary(records);
+    }
+    else {
+        print_records(records);
+    }
+    return 0;
+}